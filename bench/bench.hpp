@@ -0,0 +1,197 @@
+#pragma once
+
+// Shared helpers for the benchmarks in bench/.
+// Every benchmark is a single translation unit that includes this once.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cinttypes>
+#include <cstring>
+#include <chrono>
+#include <atomic>
+#include "socket.hpp"
+
+///////////////////////
+// allocation counts //
+///////////////////////
+
+static std::atomic<uint64_t> sBenchAllocations(0);
+
+#ifdef __GLIBC__
+// count every heap allocation made by the process, operator new ends up in here too
+extern "C" {
+void* __libc_malloc(size_t aSize);
+void* __libc_calloc(size_t aCount, size_t aSize);
+void* __libc_realloc(void* aPtr, size_t aSize);
+void __libc_free(void* aPtr);
+
+void* malloc(size_t aSize) __THROW { sBenchAllocations++; return __libc_malloc(aSize); }
+void* calloc(size_t aCount, size_t aSize) __THROW { sBenchAllocations++; return __libc_calloc(aCount, aSize); }
+void* realloc(void* aPtr, size_t aSize) __THROW { sBenchAllocations++; return __libc_realloc(aPtr, aSize); }
+void free(void* aPtr) __THROW { __libc_free(aPtr); }
+}
+#define BENCH_COUNTS_ALLOCATIONS 1
+#else
+#define BENCH_COUNTS_ALLOCATIONS 0
+#endif
+
+static uint64_t BenchAllocations() {
+    return sBenchAllocations;
+}
+
+////////////
+// timing //
+////////////
+
+static uint64_t BenchNowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+typedef struct {
+    const char* name;
+    uint64_t iterations;
+    uint64_t ns;
+    uint64_t bytes;
+    uint64_t allocations;
+} BenchResult;
+
+////////////
+// output //
+////////////
+
+// with --json every result goes into one document instead of the tables,
+// so runs can be kept and compared between releases
+static bool sBenchJson = false;
+static bool sBenchJsonFirst = true;
+static const char* sBenchGroup = "";
+
+static void sBenchJsonString(const char* aString) {
+    putchar('"');
+    for (const char* c = aString; *c; c++) {
+        if (*c == '"' || *c == '\\') { putchar('\\'); }
+        putchar(*c);
+    }
+    putchar('"');
+}
+
+static void BenchBegin(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--json")) { sBenchJson = true; }
+    }
+    if (sBenchJson) { printf("{\n  \"benchmarks\": ["); }
+}
+
+static int BenchEnd() {
+    if (sBenchJson) { printf("\n  ]\n}\n"); }
+    return 0;
+}
+
+static void BenchPrintHeader(const char* aTitle) {
+    sBenchGroup = aTitle;
+    if (sBenchJson) { return; }
+    printf("%s\n", aTitle);
+    printf("  %-32s %12s %12s %14s %12s\n", "name", "ns/op", "ops/sec", "bytes/sec", "allocs/op");
+}
+
+static void BenchPrint(const BenchResult& aResult) {
+    double seconds = aResult.ns / 1000000000.0;
+    double iterations = (double)aResult.iterations;
+    double nsPerOp = aResult.ns / iterations;
+    double opsPerSec = (seconds > 0) ? iterations / seconds : 0;
+    double bytesPerSec = (seconds > 0) ? aResult.bytes / seconds : 0;
+    double allocsPerOp = BENCH_COUNTS_ALLOCATIONS ? aResult.allocations / iterations : -1.0;
+
+    if (!sBenchJson) {
+        printf("  %-32s %12.1f %12.0f %14.0f %12.3f\n", aResult.name, nsPerOp, opsPerSec, bytesPerSec, allocsPerOp);
+        return;
+    }
+
+    printf(sBenchJsonFirst ? "\n    { " : ",\n    { ");
+    sBenchJsonFirst = false;
+    printf("\"group\": ");
+    sBenchJsonString(sBenchGroup);
+    printf(", \"name\": ");
+    sBenchJsonString(aResult.name);
+    printf(", \"iterations\": %" PRIu64 ", \"ns_per_op\": %.1f, \"ops_per_sec\": %.0f, \"bytes_per_sec\": %.0f, \"allocs_per_op\": %.3f }",
+        aResult.iterations, nsPerOp, opsPerSec, bytesPerSec, allocsPerOp);
+}
+
+////////////
+// memory //
+////////////
+
+// what the process has resident, objects that were never touched don't count
+static uint64_t BenchResidentBytes() {
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (!file) { return 0; }
+    unsigned long long size = 0;
+    unsigned long long resident = 0;
+    if (fscanf(file, "%llu %llu", &size, &resident) != 2) { resident = 0; }
+    fclose(file);
+    return (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE);
+}
+
+static void BenchPrintMemoryHeader(const char* aTitle) {
+    sBenchGroup = aTitle;
+    if (sBenchJson) { return; }
+    printf("%s\n", aTitle);
+    printf("  %-32s %12s %12s %14s\n", "name", "bytes each", "count", "total MB");
+}
+
+static void BenchPrintMemory(const char* aName, uint64_t aCount, uint64_t aBytes) {
+    double bytesPerObject = (aCount > 0) ? (double)aBytes / aCount : 0;
+    if (!sBenchJson) {
+        printf("  %-32s %12.1f %12" PRIu64 " %14.1f\n", aName, bytesPerObject, aCount, aBytes / (1024.0 * 1024.0));
+        return;
+    }
+
+    printf(sBenchJsonFirst ? "\n    { " : ",\n    { ");
+    sBenchJsonFirst = false;
+    printf("\"group\": ");
+    sBenchJsonString(sBenchGroup);
+    printf(", \"name\": ");
+    sBenchJsonString(aName);
+    printf(", \"count\": %" PRIu64 ", \"bytes\": %" PRIu64 ", \"bytes_per_object\": %.1f }", aCount, aBytes, bytesPerObject);
+}
+
+/////////////
+// sockets //
+/////////////
+
+// a connected, non-blocking tcp pair over the loopback interface
+static bool BenchSocketPair(int* aWriter, int* aReader) {
+    int listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener < 0) { return false; }
+
+    struct sockaddr_in address = { 0 };
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t len = sizeof(address);
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0) { return false; }
+    if (listen(listener, 1) != 0) { return false; }
+    if (getsockname(listener, (struct sockaddr*)&address, &len) != 0) { return false; }
+
+    *aWriter = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (connect(*aWriter, (struct sockaddr*)&address, sizeof(address)) != 0) { return false; }
+    *aReader = accept(listener, nullptr, nullptr);
+    close(listener);
+    if (*aReader < 0) { return false; }
+
+    fcntl(*aWriter, F_SETFL, fcntl(*aWriter, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(*aReader, F_SETFL, fcntl(*aReader, F_GETFL, 0) | O_NONBLOCK);
+    return true;
+}
+
+// throw away everything that is waiting on a socket
+static uint64_t BenchSocketDrain(int aSocket) {
+    static uint8_t sScratch[64 * 1024];
+    uint64_t total = 0;
+    while (true) {
+        ssize_t ret = recv(aSocket, (char*)sScratch, sizeof(sScratch), MSG_DONTWAIT);
+        if (ret <= 0) { break; }
+        total += (uint64_t)ret;
+    }
+    return total;
+}
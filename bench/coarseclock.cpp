@@ -0,0 +1,52 @@
+#include <chrono>
+#include "bench.hpp"
+#include "coarseclock.hpp"
+
+#define BENCH_READS 10000000
+
+// what every received and sent packet used to do to stamp the connection
+static BenchResult sBenchSystem(const char* aName) {
+    uint64_t sum = 0;
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < BENCH_READS; i++) {
+        std::chrono::system_clock::time_point nowTp = std::chrono::system_clock::now();
+        sum += (uint64_t)std::chrono::system_clock::to_time_t(nowTp);
+    }
+    uint64_t end = BenchNowNs();
+    if (sum == 0) { exit(1); }
+
+    return {
+        .name = aName,
+        .iterations = BENCH_READS,
+        .ns = end - start,
+        .bytes = 0,
+        .allocations = 0,
+    };
+}
+
+static BenchResult sBenchCoarse(const char* aName) {
+    CoarseClockUpdate();
+    uint64_t sum = 0;
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < BENCH_READS; i++) {
+        sum += CoarseClockNow();
+    }
+    uint64_t end = BenchNowNs();
+    if (sum == 0) { exit(1); }
+
+    return {
+        .name = aName,
+        .iterations = BENCH_READS,
+        .ns = end - start,
+        .bytes = 0,
+        .allocations = 0,
+    };
+}
+
+int main(int argc, char* argv[]) {
+    BenchBegin(argc, argv);
+    BenchPrintHeader("Reading the time (per read)");
+    BenchPrint(sBenchSystem("system_clock::now"));
+    BenchPrint(sBenchCoarse("coarse clock"));
+    return BenchEnd();
+}
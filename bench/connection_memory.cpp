@@ -0,0 +1,108 @@
+#include <thread>
+#include <chrono>
+#include <vector>
+#include "bench.hpp"
+#include "mpacket.hpp"
+#include "server.hpp"
+#include "connection.hpp"
+#include "transport.hpp"
+
+#define BENCH_CONNECTIONS 100000
+#define BENCH_TIMEOUT_NS (60ULL * 1000000000ULL)
+#define BENCH_BURST_SIZE (8 * 1024)
+
+static std::atomic<uint64_t> sReceived(0);
+static std::atomic<uint64_t> sFlushed(0);
+
+// a client that's connected but has nothing to say, everything sent to it disappears
+class IdleTransport : public Transport {
+    private:
+        bool mPartial = false;
+        bool mBlocked = false;
+
+    public:
+        int Recv(uint8_t* aData, size_t aSize, int* aError) override {
+            // the start of a packet header, the rest never arrives
+            if (mPartial) {
+                mPartial = false;
+                memset(aData, 0, 3);
+                sReceived++;
+                return 3;
+            }
+            *aError = SOCKET_EAGAIN;
+            return -1;
+        }
+        int Send(const uint8_t* aData, size_t aSize, int* aError) override {
+            if (mBlocked) {
+                *aError = SOCKET_EAGAIN;
+                return -1;
+            }
+            return (int)aSize;
+        }
+        void Close() override {}
+        void SendPartial() { mPartial = true; }
+        void Block(bool aBlocked) { mBlocked = aBlocked; }
+};
+
+int main(int argc, char* argv[]) {
+    BenchBegin(argc, argv);
+
+    gServer = new Server();
+    if (!gServer->Begin(0, 1)) {
+        printf("Failed to start server\n");
+        return 1;
+    }
+
+    BenchPrintMemoryHeader("Server memory per connection (resident)");
+
+    // idle, the way most of them sit in the lobby browser
+    std::vector<IdleTransport*> transports;
+    std::vector<uint64_t> ids;
+    transports.reserve(BENCH_CONNECTIONS);
+    ids.reserve(BENCH_CONNECTIONS);
+    uint64_t before = BenchResidentBytes();
+    for (int i = 0; i < BENCH_CONNECTIONS; i++) {
+        IdleTransport* transport = new IdleTransport();
+        transports.push_back(transport);
+        ids.push_back(gServer->ConnectionOpen(transport)->mId);
+    }
+
+    // wait for the worker to adopt every one of them
+    uint64_t deadline = BenchNowNs() + BENCH_TIMEOUT_NS;
+    while (gServer->ConnectionGet(ids.back()) == nullptr && BenchNowNs() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    uint64_t idle = BenchResidentBytes();
+    BenchPrintMemory("idle", BENCH_CONNECTIONS, idle - before);
+
+    // every one of them stuck in the middle of a packet
+    for (int i = 0; i < BENCH_CONNECTIONS; i++) {
+        transports[i]->SendPartial();
+        gServer->ConnectionPost(ids[i], [](Connection& aConnection) { aConnection.Receive(); });
+    }
+    while (sReceived < BENCH_CONNECTIONS && BenchNowNs() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    BenchPrintMemory("partial packet pending", BENCH_CONNECTIONS, BenchResidentBytes() - before);
+
+    // every one of them had a burst queued up that has since gone out,
+    // the partial packets above are still there
+    static uint8_t burst[BENCH_BURST_SIZE] = { 0 };
+    for (int i = 0; i < BENCH_CONNECTIONS; i++) {
+        IdleTransport* transport = transports[i];
+        gServer->ConnectionPost(ids[i], [transport](Connection& aConnection) {
+            transport->Block(true);
+            aConnection.Send(burst, sizeof(burst));
+            transport->Block(false);
+            aConnection.Flush();
+            sFlushed++;
+        });
+    }
+    while (sFlushed < BENCH_CONNECTIONS && BenchNowNs() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BenchPrintMemory("after a drained burst", BENCH_CONNECTIONS, BenchResidentBytes() - before);
+
+    return BenchEnd();
+}
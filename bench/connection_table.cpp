@@ -0,0 +1,93 @@
+#include <map>
+#include <vector>
+#include "bench.hpp"
+#include "connection.hpp"
+#include "connectiontable.hpp"
+
+#define BENCH_SCANS 100
+#define BENCH_NOW 1000000
+
+// what a sweep over every connection used to cost, a map walk and a whole connection per entry
+static BenchResult sBenchMap(const char* aName, int aConnections) {
+    std::map<uint64_t, Connection*> connections;
+    for (int i = 0; i < aConnections; i++) {
+        Connection* connection = new Connection((uint64_t)i + 1);
+        connection->mActive = true;
+        connections[connection->mId] = connection;
+    }
+
+    uint64_t due = 0;
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < BENCH_SCANS; i++) {
+        for (auto& it : connections) {
+            Connection* connection = it.second;
+            if (!connection->mActive) { continue; }
+            if ((connection->LastSendTime() + CONNECTION_KEEP_ALIVE_SECS) < BENCH_NOW) { due++; }
+        }
+    }
+    uint64_t end = BenchNowNs();
+
+    if (due != (uint64_t)aConnections * BENCH_SCANS) {
+        printf("Missed connections: %" PRIu64 "\n", due);
+        exit(1);
+    }
+    for (auto& it : connections) {
+        delete it.second;
+    }
+
+    return {
+        .name = aName,
+        .iterations = BENCH_SCANS,
+        .ns = end - start,
+        .bytes = 0,
+        .allocations = 0,
+    };
+}
+
+// the same sweep through the packed arrays
+static BenchResult sBenchTable(const char* aName, int aConnections) {
+    ConnectionTable table;
+    std::vector<Connection*> connections;
+    for (int i = 0; i < aConnections; i++) {
+        Connection* connection = new Connection((uint64_t)i + 1);
+        connection->mActive = true;
+        connections.push_back(connection);
+        table.Add(connection);
+    }
+
+    uint64_t due = 0;
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < BENCH_SCANS; i++) {
+        for (uint32_t slot = 0; slot < table.Size(); slot++) {
+            if (!table.Active(slot)) { continue; }
+            if ((table.LastSendTime(slot) + CONNECTION_KEEP_ALIVE_SECS) < BENCH_NOW) { due++; }
+        }
+    }
+    uint64_t end = BenchNowNs();
+
+    if (due != (uint64_t)aConnections * BENCH_SCANS) {
+        printf("Missed connections: %" PRIu64 "\n", due);
+        exit(1);
+    }
+    for (auto& it : connections) {
+        delete it;
+    }
+
+    return {
+        .name = aName,
+        .iterations = BENCH_SCANS,
+        .ns = end - start,
+        .bytes = 0,
+        .allocations = 0,
+    };
+}
+
+int main(int argc, char* argv[]) {
+    BenchBegin(argc, argv);
+    BenchPrintHeader("Keep-alive sweep (per sweep over every connection)");
+    BenchPrint(sBenchMap("10k connections (map)", 10000));
+    BenchPrint(sBenchTable("10k connections (table)", 10000));
+    BenchPrint(sBenchMap("100k connections (map)", 100000));
+    BenchPrint(sBenchTable("100k connections (table)", 100000));
+    return BenchEnd();
+}
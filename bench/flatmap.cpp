@@ -0,0 +1,104 @@
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <random>
+#include "bench.hpp"
+#include "flatmap.hpp"
+
+#define BENCH_LOOKUPS 2000000
+
+// the lookup a relay does for its destination: random ids, most of them present
+static std::vector<uint64_t> sIds;
+static std::vector<uint64_t> sLookups;
+
+static void sBenchSetup(int aEntries) {
+    std::mt19937_64 prng(aEntries);
+    sIds.clear();
+    sLookups.clear();
+    for (int i = 0; i < aEntries; i++) {
+        sIds.push_back(prng());
+    }
+    for (int i = 0; i < BENCH_LOOKUPS; i++) {
+        // one in sixteen asks for someone who already left
+        sLookups.push_back((i % 16 == 0) ? prng() : sIds[prng() % aEntries]);
+    }
+}
+
+template <typename M>
+static BenchResult sBenchStd(const char* aName) {
+    M map;
+    for (auto& id : sIds) {
+        map[id] = id;
+    }
+
+    uint64_t found = 0;
+    uint64_t start = BenchNowNs();
+    for (auto& id : sLookups) {
+        auto it = map.find(id);
+        if (it != map.end()) { found += it->second; }
+    }
+    uint64_t end = BenchNowNs();
+    if (found == 0) { exit(1); }
+
+    return {
+        .name = aName,
+        .iterations = BENCH_LOOKUPS,
+        .ns = end - start,
+        .bytes = 0,
+        .allocations = 0,
+    };
+}
+
+static BenchResult sBenchFlat(const char* aName) {
+    FlatMap<uint64_t> map;
+    for (auto& id : sIds) {
+        map.Insert(id, id);
+    }
+
+    uint64_t found = 0;
+    uint64_t start = BenchNowNs();
+    for (auto& id : sLookups) {
+        uint64_t* value = map.Find(id);
+        if (value) { found += *value; }
+    }
+    uint64_t end = BenchNowNs();
+    if (found == 0) { exit(1); }
+
+    // same answers as a std::map would give
+    for (auto& id : sIds) {
+        uint64_t* value = map.Find(id);
+        if (!value || *value != id) {
+            printf("Lost id %" PRIu64 "\n", id);
+            exit(1);
+        }
+    }
+
+    return {
+        .name = aName,
+        .iterations = BENCH_LOOKUPS,
+        .ns = end - start,
+        .bytes = 0,
+        .allocations = 0,
+    };
+}
+
+int main(int argc, char* argv[]) {
+    BenchBegin(argc, argv);
+    BenchPrintHeader("Relay lookup by id (per lookup)");
+
+    sBenchSetup(10000);
+    BenchPrint(sBenchStd<std::map<uint64_t, uint64_t>>("10k std::map"));
+    BenchPrint(sBenchStd<std::unordered_map<uint64_t, uint64_t>>("10k std::unordered_map"));
+    BenchPrint(sBenchFlat("10k flat map"));
+
+    sBenchSetup(100000);
+    BenchPrint(sBenchStd<std::map<uint64_t, uint64_t>>("100k std::map"));
+    BenchPrint(sBenchStd<std::unordered_map<uint64_t, uint64_t>>("100k std::unordered_map"));
+    BenchPrint(sBenchFlat("100k flat map"));
+
+    sBenchSetup(1000000);
+    BenchPrint(sBenchStd<std::map<uint64_t, uint64_t>>("1M std::map"));
+    BenchPrint(sBenchStd<std::unordered_map<uint64_t, uint64_t>>("1M std::unordered_map"));
+    BenchPrint(sBenchFlat("1M flat map"));
+    return BenchEnd();
+}
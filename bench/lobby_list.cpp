@@ -0,0 +1,136 @@
+#include <string>
+#include <vector>
+#include <map>
+#include "bench.hpp"
+#include "lobby.hpp"
+#include "lobbydirectory.hpp"
+#include "connection.hpp"
+
+#define BENCH_GAMES 50
+#define BENCH_PUBLIC_PER_GAME 20
+#define BENCH_QUERIES 20000
+#define BENCH_SCANNED_LOBBIES 100000000
+#define BENCH_LIST_REQUESTS 20000
+
+// every game has the same handful of public lobbies, everything else is
+// private, so a public list request always matches the same amount
+static BenchResult sBenchList(const char* aName, int aLobbies, bool aLegacy) {
+    std::vector<std::string> games;
+    for (int i = 0; i < BENCH_GAMES; i++) {
+        games.push_back("game" + std::to_string(i));
+    }
+    std::string empty = "";
+
+    std::map<uint64_t, Lobby*> lobbies;
+    LobbyDirectory directory;
+    for (int i = 0; i < aLobbies; i++) {
+        std::string& game = games[i % BENCH_GAMES];
+        std::string password = (i < BENCH_GAMES * BENCH_PUBLIC_PER_GAME) ? "" : "pw" + std::to_string(i);
+        Lobby* lobby = new Lobby(nullptr, i + 1, game, empty, empty, empty, 16, password, empty);
+        lobbies[lobby->mId] = lobby;
+        directory.Add(lobby);
+    }
+
+    // a scan touches every lobby, so it gets fewer queries
+    int queries = BENCH_QUERIES;
+    if (aLegacy && queries > BENCH_SCANNED_LOBBIES / aLobbies) { queries = BENCH_SCANNED_LOBBIES / aLobbies; }
+
+    uint64_t matches = 0;
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < queries; i++) {
+        StringView game = games[i % BENCH_GAMES];
+        StringView password = empty;
+        if (aLegacy) {
+            for (auto& it : lobbies) {
+                if (game != it.second->mGame) { continue; }
+                if (password != it.second->mPassword) { continue; }
+                matches++;
+            }
+        } else {
+            const std::vector<Lobby*>* bucket = directory.Find(game, password);
+            if (!bucket) { continue; }
+            for (auto& it : *bucket) {
+                if (game != it->mGame) { continue; }
+                if (password != it->mPassword) { continue; }
+                matches++;
+            }
+        }
+    }
+    uint64_t end = BenchNowNs();
+
+    if (matches != (uint64_t)queries * BENCH_PUBLIC_PER_GAME) {
+        printf("Unexpected matches: %" PRIu64 "\n", matches);
+        exit(1);
+    }
+
+    for (auto& it : lobbies) {
+        directory.Remove(it.second);
+        delete it.second;
+    }
+
+    return {
+        .name = aName,
+        .iterations = (uint64_t)queries,
+        .ns = end - start,
+        .bytes = 0,
+        .allocations = 0,
+    };
+}
+
+// a public list request for a game, either re-encoded every time or served from the cache
+static BenchResult sBenchListEncode(const char* aName, int aLobbies, bool aCached) {
+    std::string game = "sm64coopdx";
+    std::string empty = "";
+    std::string text = "some text";
+    std::string description(200, 'd');
+    Connection owner(1);
+
+    LobbyDirectory directory;
+    std::vector<Lobby*> lobbies;
+    for (int i = 0; i < aLobbies; i++) {
+        Lobby* lobby = new Lobby(&owner, i + 1, game, text, text, text, 16, empty, description);
+        lobbies.push_back(lobby);
+        directory.Add(lobby);
+    }
+
+    uint64_t bytes = 0;
+    uint64_t allocations = BenchAllocations();
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < BENCH_LIST_REQUESTS; i++) {
+        if (!aCached) { directory.Invalidate(lobbies[i % aLobbies]); }
+        bytes += directory.List(game, empty)->bytes.size();
+    }
+    uint64_t end = BenchNowNs();
+    allocations = BenchAllocations() - allocations;
+
+    for (auto& it : lobbies) {
+        directory.Remove(it);
+        delete it;
+    }
+
+    return {
+        .name = aName,
+        .iterations = BENCH_LIST_REQUESTS,
+        .ns = end - start,
+        .bytes = bytes,
+        .allocations = allocations,
+    };
+}
+
+int main(int argc, char* argv[]) {
+    BenchBegin(argc, argv);
+    BenchPrintHeader("Lobby list query (per query, 50 games, 20 public lobbies each)");
+    BenchPrint(sBenchList("1k lobbies (scan)", 1000, true));
+    BenchPrint(sBenchList("1k lobbies", 1000, false));
+    BenchPrint(sBenchList("10k lobbies (scan)", 10000, true));
+    BenchPrint(sBenchList("10k lobbies", 10000, false));
+    BenchPrint(sBenchList("100k lobbies (scan)", 100000, true));
+    BenchPrint(sBenchList("100k lobbies", 100000, false));
+
+    BenchPrintHeader("Lobby list response (per request, public lobbies in one game)");
+    BenchPrint(sBenchListEncode("10 lobbies (encoded)", 10, false));
+    BenchPrint(sBenchListEncode("10 lobbies", 10, true));
+    BenchPrint(sBenchListEncode("100 lobbies (encoded)", 100, false));
+    BenchPrint(sBenchListEncode("100 lobbies", 100, true));
+    return BenchEnd();
+}
@@ -0,0 +1,97 @@
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "mpacket.hpp"
+#include "connection.hpp"
+#include "lobby.hpp"
+#include "worker.hpp"
+
+#define BENCH_MEMBER_SENDS 2000000
+#define BENCH_FOREIGN_MEMBER_SENDS 200000
+
+// every member writes into the same loopback socket, only the encoding and the
+// per-member bookkeeping differ between the two cases.
+// foreign members belong to a worker that never runs, so their sends pile up in its queue
+static BenchResult sBenchBroadcast(const char* aName, MPacket& aPacket, int aMembers, int aWriter, int aReader, bool aPerMember, bool aForeign) {
+    Worker worker;
+    ConnectionTable table;
+    std::string game = "sm64coopdx";
+    std::string empty = "";
+    std::vector<Connection*> connections;
+    for (int i = 0; i < aMembers; i++) {
+        Connection* connection = new Connection(i + 1);
+        connection->mTransport = new SocketTransport(aWriter);
+        connection->mActive = true;
+        connection->mWorker = aForeign ? &worker : nullptr;
+        connections.push_back(connection);
+
+        // members are reached through the table, like a worker's
+        table.Add(connection);
+    }
+    Lobby lobby(connections[0], 1, game, empty, empty, empty, aMembers, empty, empty);
+    for (auto& it : connections) {
+        lobby.mConnections.push_back(it->Ref());
+    }
+
+    int rounds = (aForeign ? BENCH_FOREIGN_MEMBER_SENDS : BENCH_MEMBER_SENDS) / aMembers;
+    uint64_t bytes = 0;
+    uint64_t allocations = BenchAllocations();
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < rounds; i++) {
+        if (aPerMember) {
+            for (auto& it : connections) {
+                aPacket.Send(*it);
+            }
+        } else {
+            aPacket.Send(lobby);
+        }
+        bytes += BenchSocketDrain(aReader);
+    }
+    uint64_t end = BenchNowNs();
+    allocations = BenchAllocations() - allocations;
+
+    lobby.mConnections.clear();
+    for (auto& it : connections) {
+        delete it;
+    }
+
+    return {
+        .name = aName,
+        .iterations = (uint64_t)rounds,
+        .ns = end - start,
+        .bytes = bytes,
+        .allocations = allocations,
+    };
+}
+
+int main(int argc, char* argv[]) {
+    BenchBegin(argc, argv);
+    int writer = -1;
+    int reader = -1;
+    if (!BenchSocketPair(&writer, &reader)) {
+        printf("Failed to create socket pair\n");
+        return 1;
+    }
+
+    MPacketLobbyJoined joined({
+        .lobbyId = 1234,
+        .userId = 5678,
+        .ownerId = 9012,
+        .destId = 3456,
+        .priority = 2
+    });
+
+    BenchPrintHeader("MPacket::Send(Lobby&) (per broadcast)");
+    BenchPrint(sBenchBroadcast("lobby_joined x16 (per member)", joined, 16, writer, reader, true, false));
+    BenchPrint(sBenchBroadcast("lobby_joined x16", joined, 16, writer, reader, false, false));
+    BenchPrint(sBenchBroadcast("lobby_joined x256 (per member)", joined, 256, writer, reader, true, false));
+    BenchPrint(sBenchBroadcast("lobby_joined x256", joined, 256, writer, reader, false, false));
+    BenchPrint(sBenchBroadcast("foreign x16 (per member)", joined, 16, writer, reader, true, true));
+    BenchPrint(sBenchBroadcast("foreign x16", joined, 16, writer, reader, false, true));
+    BenchPrint(sBenchBroadcast("foreign x256 (per member)", joined, 256, writer, reader, true, true));
+    BenchPrint(sBenchBroadcast("foreign x256", joined, 256, writer, reader, false, true));
+
+    close(writer);
+    close(reader);
+    return BenchEnd();
+}
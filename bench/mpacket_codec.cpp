@@ -0,0 +1,147 @@
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "mpacket.hpp"
+
+#define BENCH_PACKETS 400000
+#define BENCH_BURST 32
+#define BENCH_LOOPBACK_SIZE (1024 * 1024)
+
+typedef struct {
+    const char* name;
+    MPacket* packet;
+} BenchPacket;
+
+static uint64_t sDecoded = 0;
+
+// the parsing half of MPacket::Process, without handing the packet to a server or client
+static void sDecodeOnly(Connection* aConnection, uint8_t* aData) {
+    if (MPacket::Decode(aData)) { sDecoded++; }
+}
+
+// serializes the packet the way Send does, into an in-memory loopback
+// that is rewound whenever the next packet might not fit
+static BenchResult sBenchEncode(const BenchPacket& aPacket) {
+    static uint8_t sLoopback[BENCH_LOOPBACK_SIZE];
+    int64_t offset = 0;
+    uint64_t bytes = 0;
+
+    uint64_t allocations = BenchAllocations();
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < BENCH_PACKETS; i++) {
+        if (offset + (int64_t)MPACKET_MAX_SIZE > BENCH_LOOPBACK_SIZE) { offset = 0; }
+        int64_t size = aPacket.packet->Serialize(&sLoopback[offset], MPACKET_MAX_SIZE);
+        if (size <= 0) {
+            printf("Failed to encode %s\n", aPacket.name);
+            exit(1);
+        }
+        offset += size;
+        bytes += (uint64_t)size;
+    }
+    uint64_t end = BenchNowNs();
+
+    return {
+        .name = aPacket.name,
+        .iterations = BENCH_PACKETS,
+        .ns = end - start,
+        .bytes = bytes,
+        .allocations = BenchAllocations() - allocations,
+    };
+}
+
+// reads bursts of the packet back out of a receive buffer, as a single recv() would hand them over
+static BenchResult sBenchDecode(const BenchPacket& aPacket) {
+    static uint8_t sBurst[MPACKET_MAX_SIZE];
+    static uint8_t sData[MPACKET_MAX_SIZE];
+
+    int burst = 0;
+    int64_t burstSize = 0;
+    while (burst < BENCH_BURST) {
+        int64_t size = aPacket.packet->Serialize(&sBurst[burstSize], MPACKET_MAX_SIZE - burstSize);
+        if (size <= 0) { break; }
+        burstSize += size;
+        burst++;
+    }
+    if (burst == 0) {
+        printf("Failed to encode %s\n", aPacket.name);
+        exit(1);
+    }
+
+    int rounds = BENCH_PACKETS / burst;
+    sDecoded = 0;
+    uint64_t allocations = BenchAllocations();
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < rounds; i++) {
+        memcpy(sData, sBurst, burstSize);
+        int64_t dataSize = burstSize;
+        MPacket::Read(nullptr, sData, &dataSize, MPACKET_MAX_SIZE, sDecodeOnly);
+    }
+    uint64_t end = BenchNowNs();
+    allocations = BenchAllocations() - allocations;
+
+    if (sDecoded != (uint64_t)rounds * burst) {
+        printf("Failed to decode %s: %" PRIu64 " of %" PRIu64 "\n", aPacket.name, sDecoded, (uint64_t)rounds * burst);
+        exit(1);
+    }
+
+    return {
+        .name = aPacket.name,
+        .iterations = (uint64_t)rounds * burst,
+        .ns = end - start,
+        .bytes = (uint64_t)rounds * burstSize,
+        .allocations = allocations,
+    };
+}
+
+int main(int argc, char* argv[]) {
+    BenchBegin(argc, argv);
+
+    std::string sdp = "v=0\r\no=- 4611731400430051336 2 IN IP4 127.0.0.1\r\ns=-\r\nt=0 0\r\na=group:BUNDLE 0\r\n"
+                      "a=msid-semantic: WMS\r\nm=application 9 UDP/DTLS/SCTP webrtc-datachannel\r\nc=IN IP4 0.0.0.0\r\n"
+                      "a=ice-ufrag:4ZcD\r\na=ice-pwd:2/1muCWoOi3uLifh0NuRHlZC\r\na=ice-options:trickle\r\n"
+                      "a=fingerprint:sha-256 7B:8B:F0:65:5F:78:E2:51:3B:AC:6F:F3:3F:46:1B:35:DC:B8:5F:64:1A:24:C2:43:F0:A1:58:D0:A1:2C:19:08\r\n"
+                      "a=setup:actpass\r\na=mid:0\r\na=sctp-port:5000\r\na=max-message-size:262144\r\n";
+    std::string description(200, 'd');
+
+    std::vector<BenchPacket> packets = {
+        { "joined", new MPacketJoined({ .userId = 5678, .version = MPACKET_PROTOCOL_VERSION }) },
+        { "lobby_create", new MPacketLobbyCreate({ .maxConnections = 16 },
+            { "sm64coopdx", "v1.0", "Host's Name", "Super Mario 64", "", description }) },
+        { "lobby_created", new MPacketLobbyCreated({ .lobbyId = 1234, .maxConnections = 16 },
+            { "sm64coopdx", "v1.0", "Host's Name", "Super Mario 64" }) },
+        { "lobby_update", new MPacketLobbyUpdate({ .lobbyId = 1234 },
+            { "sm64coopdx", "v1.0", "Host's Name", "Super Mario 64", description }) },
+        { "lobby_join", new MPacketLobbyJoin({ .lobbyId = 1234 }, { "" }) },
+        { "lobby_joined", new MPacketLobbyJoined({ .lobbyId = 1234, .userId = 5678, .ownerId = 9012, .destId = 3456, .priority = 2 }) },
+        { "lobby_leave", new MPacketLobbyLeave({ .lobbyId = 1234 }) },
+        { "lobby_left", new MPacketLobbyLeft({ .lobbyId = 1234, .userId = 5678 }) },
+        { "lobby_list_get", new MPacketLobbyListGet({}, { "sm64coopdx", "" }) },
+        { "lobby_list_got", new MPacketLobbyListGot({ .lobbyId = 1234, .ownerId = 5678, .connections = 3, .maxConnections = 16 },
+            { "sm64coopdx", "v1.0", "Host's Name", "Super Mario 64", description }) },
+        { "lobby_list_finish", new MPacketLobbyListFinish({ .unused = 0 }) },
+        { "peer_sdp", new MPacketPeerSdp({ .lobbyId = 1234, .userId = 5678 }, { sdp }) },
+        { "peer_candidate", new MPacketPeerCandidate({ .lobbyId = 1234, .userId = 5678 },
+            { "a=candidate:1 1 UDP 2122317823 192.168.1.20 51234 typ host" }) },
+        { "peer_candidate_done", new MPacketPeerCandidateDone({ .lobbyId = 1234, .userId = 5678 }) },
+        { "peer_failed", new MPacketPeerFailed({ .lobbyId = 1234, .peerId = 5678 }) },
+        { "stun_turn", new MPacketStunTurn({ .isStun = 0, .port = 3478 }, { "turn.example.com", "username", "password" }) },
+        { "error", new MPacketError({ .errorNumber = 1, .tag = 1234 }) },
+        { "keep_alive", new MPacketKeepAlive({ .errorNumber = 0, .tag = 0 }) },
+        { "info", new MPacketInfo({ .destId = 3456, .infoBits = 7919, .hash = 1234567 }, { "Player Name" }) },
+        { "load_balance", new MPacketLoadBalance({ .port = 34198 }, { "coopnet.example.com" }) },
+    };
+
+    char title[64];
+    snprintf(title, sizeof(title), "MPacket encode (protocol %u, per packet)", MPACKET_PROTOCOL_VERSION);
+    BenchPrintHeader(title);
+    for (auto& it : packets) {
+        BenchPrint(sBenchEncode(it));
+    }
+
+    snprintf(title, sizeof(title), "MPacket decode (protocol %u, per packet)", MPACKET_PROTOCOL_VERSION);
+    BenchPrintHeader(title);
+    for (auto& it : packets) {
+        BenchPrint(sBenchDecode(it));
+    }
+    return BenchEnd();
+}
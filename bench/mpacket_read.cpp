@@ -0,0 +1,95 @@
+#include <string>
+#include "bench.hpp"
+#include "mpacket.hpp"
+#include "connection.hpp"
+
+#define BENCH_PACKETS 400000
+
+// the receive path as it was before the read cursor:
+// the rest of the buffer is shifted down a byte at a time after every packet
+static void sLegacyRead(Connection* connection, uint8_t* aData, int64_t* aDataSize) {
+    while (true) {
+        MPacketHeader header = *(MPacketHeader*)aData;
+        int64_t totalSize = sizeof(MPacketHeader) + header.dataSize + header.stringSize;
+        if (*aDataSize < totalSize) {
+            return;
+        }
+
+        MPacket::Process(connection, aData);
+
+        int64_t j = 0;
+        for (int64_t i = totalSize; i < *aDataSize; i++) {
+            aData[j++] = aData[i];
+        }
+        *aDataSize -= totalSize;
+    }
+}
+
+// decodes a pipelined burst of packets, as a single recv() would hand it over,
+// with half of the next packet trailing behind so the leftovers have to be kept
+static BenchResult sBenchRead(const char* aName, MPacket& aPacket, int aBurst, bool aLegacy) {
+    static uint8_t sBurst[MPACKET_MAX_SIZE];
+    static uint8_t sData[MPACKET_MAX_SIZE];
+    Connection connection(1);
+
+    int64_t burstSize = 0;
+    int64_t packetSize = 0;
+    for (int i = 0; i < aBurst; i++) {
+        packetSize = aPacket.Serialize(&sBurst[burstSize], MPACKET_MAX_SIZE - burstSize);
+        if (packetSize < 0) {
+            printf("Burst of %d does not fit in the receive buffer\n", aBurst);
+            exit(1);
+        }
+        burstSize += packetSize;
+    }
+    burstSize += aPacket.Serialize(&sBurst[burstSize], MPACKET_MAX_SIZE - burstSize) / 2;
+
+    int rounds = BENCH_PACKETS / aBurst;
+    uint64_t allocations = BenchAllocations();
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < rounds; i++) {
+        memcpy(sData, sBurst, burstSize);
+        int64_t dataSize = burstSize;
+        if (aLegacy) {
+            sLegacyRead(&connection, sData, &dataSize);
+        } else {
+            MPacket::Read(&connection, sData, &dataSize, MPACKET_MAX_SIZE);
+        }
+        if (dataSize != packetSize / 2) {
+            printf("Unexpected leftover: %" PRId64 "\n", dataSize);
+            exit(1);
+        }
+    }
+    uint64_t end = BenchNowNs();
+
+    return {
+        .name = aName,
+        .iterations = (uint64_t)rounds * aBurst,
+        .ns = end - start,
+        .bytes = (uint64_t)rounds * burstSize,
+        .allocations = BenchAllocations() - allocations,
+    };
+}
+
+int main(int argc, char* argv[]) {
+    BenchBegin(argc, argv);
+    MPacketKeepAlive keepAlive({ .errorNumber = 0, .tag = 0 });
+    MPacketLobbyListGot listGot({
+        .lobbyId = 1234,
+        .ownerId = 5678,
+        .connections = 3,
+        .maxConnections = 16
+    }, { "sm64coopdx", "v1.0", "Host's Name", "Super Mario 64", std::string(200, 'd') });
+
+    BenchPrintHeader("MPacket::Read (per packet)");
+    BenchPrint(sBenchRead("keep_alive x1 (legacy)", keepAlive, 1, true));
+    BenchPrint(sBenchRead("keep_alive x1", keepAlive, 1, false));
+    BenchPrint(sBenchRead("keep_alive x25 (legacy)", keepAlive, 25, true));
+    BenchPrint(sBenchRead("keep_alive x25", keepAlive, 25, false));
+    BenchPrint(sBenchRead("keep_alive x100 (legacy)", keepAlive, 100, true));
+    BenchPrint(sBenchRead("keep_alive x100", keepAlive, 100, false));
+    BenchPrint(sBenchRead("keep_alive x200 (legacy)", keepAlive, 200, true));
+    BenchPrint(sBenchRead("keep_alive x200", keepAlive, 200, false));
+    BenchPrint(sBenchRead("lobby_list_got x10", listGot, 10, false));
+    return BenchEnd();
+}
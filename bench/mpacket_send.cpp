@@ -0,0 +1,125 @@
+#include <string>
+#include "bench.hpp"
+#include "mpacket.hpp"
+#include "connection.hpp"
+
+#define BENCH_ITERATIONS 200000
+#define BENCH_DRAIN_EVERY 32
+
+// the send path as it was before serializing into a reusable buffer:
+// one malloc per packet and a strlen-driven byte loop per string
+template <typename T>
+class LegacyPacket : public T {
+    public:
+        using T::T;
+
+        void LegacySend(Connection& connection) {
+            int64_t stringSize = 0;
+            for (const auto& s : this->mStringData) {
+                stringSize += sizeof(uint16_t) + strlen(s.c_str());
+            }
+
+            MPacketHeader pHeader = {
+                .packetType = static_cast<uint16_t>(this->GetImplSettings().packetType),
+                .dataSize = (uint16_t)this->mVoidDataSize,
+                .stringSize = (uint16_t)stringSize
+            };
+            int64_t dataSize = sizeof(MPacketHeader) + pHeader.dataSize + pHeader.stringSize;
+
+            uint8_t* data = (uint8_t*)malloc(dataSize);
+            uint8_t* d = &data[0];
+            memcpy(d, &pHeader, sizeof(MPacketHeader));
+            d += sizeof(MPacketHeader);
+            memcpy(d, this->mVoidData, this->mVoidDataSize);
+            d += this->mVoidDataSize;
+            for (const auto& s : this->mStringData) {
+                const char* c = s.c_str();
+                uint16_t slength = strlen(c);
+                *((uint16_t*)d) = slength;
+                d += sizeof(uint16_t);
+                for (uint16_t i = 0; i < slength; i++) {
+                    *d = *c;
+                    d++;
+                    c++;
+                }
+            }
+
+            connection.Send(data, dataSize);
+            free(data);
+        }
+};
+
+template <typename T>
+static BenchResult sBenchSend(const char* aName, T& aPacket, Connection& aConnection, int aReader, bool aLegacy) {
+    // warm up the socket buffers and the outbound queue
+    for (int i = 0; i < 1000; i++) {
+        if (aLegacy) { aPacket.LegacySend(aConnection); } else { aPacket.Send(aConnection); }
+        if ((i % BENCH_DRAIN_EVERY) == 0) { BenchSocketDrain(aReader); }
+    }
+    BenchSocketDrain(aReader);
+
+    uint64_t bytes = 0;
+    uint64_t allocations = BenchAllocations();
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        if (aLegacy) { aPacket.LegacySend(aConnection); } else { aPacket.Send(aConnection); }
+        if ((i % BENCH_DRAIN_EVERY) == 0) { bytes += BenchSocketDrain(aReader); }
+    }
+    uint64_t end = BenchNowNs();
+    allocations = BenchAllocations() - allocations;
+    bytes += BenchSocketDrain(aReader);
+
+    return {
+        .name = aName,
+        .iterations = BENCH_ITERATIONS,
+        .ns = end - start,
+        .bytes = bytes,
+        .allocations = allocations,
+    };
+}
+
+int main(int argc, char* argv[]) {
+    BenchBegin(argc, argv);
+    int writer = -1;
+    int reader = -1;
+    if (!BenchSocketPair(&writer, &reader)) {
+        printf("Failed to create socket pair\n");
+        return 1;
+    }
+
+    Connection connection(1);
+    connection.mTransport = new SocketTransport(writer);
+    connection.mActive = true;
+
+    LegacyPacket<MPacketLobbyListGot> listGot({
+        .lobbyId = 1234,
+        .ownerId = 5678,
+        .connections = 3,
+        .maxConnections = 16
+    }, { "sm64coopdx", "v1.0", "Host's Name", "Super Mario 64", std::string(200, 'd') });
+
+    LegacyPacket<MPacketPeerCandidate> candidate({
+        .lobbyId = 1234,
+        .userId = 5678
+    }, { "a=candidate:1 1 UDP 2122317823 192.168.1.20 51234 typ host" });
+
+    LegacyPacket<MPacketLobbyJoined> joined({
+        .lobbyId = 1234,
+        .userId = 5678,
+        .ownerId = 9012,
+        .destId = 3456,
+        .priority = 2
+    });
+
+    BenchPrintHeader("MPacket::Send");
+    BenchPrint(sBenchSend("lobby_list_got (legacy)", listGot, connection, reader, true));
+    BenchPrint(sBenchSend("lobby_list_got", listGot, connection, reader, false));
+    BenchPrint(sBenchSend("peer_candidate (legacy)", candidate, connection, reader, true));
+    BenchPrint(sBenchSend("peer_candidate", candidate, connection, reader, false));
+    BenchPrint(sBenchSend("lobby_joined (legacy)", joined, connection, reader, true));
+    BenchPrint(sBenchSend("lobby_joined", joined, connection, reader, false));
+
+    close(writer);
+    close(reader);
+    return BenchEnd();
+}
@@ -0,0 +1,102 @@
+#include <string>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include "bench.hpp"
+#include "mpacket.hpp"
+#include "server.hpp"
+#include "transport.hpp"
+#include "libcoopnet.h"
+
+#define BENCH_CONNECTIONS 64
+#define BENCH_CHECK_MS 10
+#define BENCH_TIMEOUT_NS (10ULL * 1000000000ULL)
+
+// stands in for a ban lookup that has to ask someone else
+static bool sSlowCheck(Connection* aConnection, bool aNewConnection) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_CHECK_MS));
+    return true;
+}
+
+// reads until the joined packet shows up, it's always the first one
+static void sWaitJoined(Transport* aTransport) {
+    uint8_t buffer[sizeof(MPacketHeader)];
+    size_t size = 0;
+    uint64_t deadline = BenchNowNs() + BENCH_TIMEOUT_NS;
+    while (size < sizeof(buffer)) {
+        int error = 0;
+        int ret = aTransport->Recv(&buffer[size], sizeof(buffer) - size, &error);
+        if (ret > 0) { size += (size_t)ret; continue; }
+        if (ret == 0 || (error != SOCKET_EAGAIN && error != SOCKET_EWOULDBLOCK) || BenchNowNs() > deadline) {
+            printf("Never joined (%d)\n", error);
+            exit(1);
+        }
+        std::this_thread::yield();
+    }
+
+    MPacketHeader header;
+    memcpy(&header, buffer, sizeof(header));
+    if (header.packetType != MPACKET_JOINED) {
+        printf("Expected joined, got %u\n", header.packetType);
+        exit(1);
+    }
+}
+
+// how long opening takes for the caller of ConnectionOpen, the accept thread in the real server,
+// and how long until every connection has been let in
+static void sBenchOpen(const char* aOpenName, const char* aJoinedName, bool aSlowCheck) {
+    gCoopNetCallbacks.ConnectionIsAllowed = aSlowCheck ? sSlowCheck : nullptr;
+
+    std::vector<Transport*> clients;
+    uint64_t allocations = BenchAllocations();
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < BENCH_CONNECTIONS; i++) {
+        PipeTransport* clientEnd = nullptr;
+        PipeTransport* serverEnd = nullptr;
+        PipeTransport::Create(&clientEnd, &serverEnd);
+        clients.push_back(clientEnd);
+        gServer->ConnectionOpen(serverEnd);
+    }
+    uint64_t opened = BenchNowNs();
+    allocations = BenchAllocations() - allocations;
+
+    for (auto& it : clients) {
+        sWaitJoined(it);
+    }
+    uint64_t joined = BenchNowNs();
+
+    for (auto& it : clients) {
+        it->Close();
+        delete it;
+    }
+
+    BenchPrint({
+        .name = aOpenName,
+        .iterations = BENCH_CONNECTIONS,
+        .ns = opened - start,
+        .bytes = 0,
+        .allocations = allocations,
+    });
+    BenchPrint({
+        .name = aJoinedName,
+        .iterations = BENCH_CONNECTIONS,
+        .ns = joined - start,
+        .bytes = 0,
+        .allocations = 0,
+    });
+}
+
+int main(int argc, char* argv[]) {
+    BenchBegin(argc, argv);
+
+    gServer = new Server();
+    if (!gServer->Begin(0, 1)) {
+        printf("Failed to start server\n");
+        return 1;
+    }
+
+    BenchPrintHeader("Connection open (per connection, 64 at once, 4 admission threads)");
+    sBenchOpen("open, no check", "joined, no check", false);
+    sBenchOpen("open, 10 ms check", "joined, 10 ms check", true);
+    return BenchEnd();
+}
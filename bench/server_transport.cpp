@@ -0,0 +1,182 @@
+#include <string>
+#include <thread>
+#include "bench.hpp"
+#include "mpacket.hpp"
+#include "server.hpp"
+#include "transport.hpp"
+
+#define BENCH_ROUND_TRIPS 20000
+#define BENCH_TIMEOUT_NS (5ULL * 1000000000ULL)
+#define BENCH_CLIENT_BUFFER (64 * 1024)
+
+// the client half of a connection, driven straight through its transport
+typedef struct {
+    Transport* transport;
+    uint8_t buffer[BENCH_CLIENT_BUFFER];
+    size_t size;
+    uint64_t id;
+} BenchClient;
+
+static void sClientSend(BenchClient& aClient, MPacket& aPacket) {
+    static uint8_t sData[MPACKET_MAX_SIZE];
+    int64_t size = aPacket.Serialize(sData, MPACKET_MAX_SIZE);
+    if (size <= 0) {
+        printf("Failed to encode packet\n");
+        exit(1);
+    }
+
+    int64_t sent = 0;
+    while (sent < size) {
+        int error = 0;
+        int ret = aClient.transport->Send(&sData[sent], (size_t)(size - sent), &error);
+        if (ret > 0) { sent += ret; continue; }
+        if (error != SOCKET_EAGAIN && error != SOCKET_EWOULDBLOCK) {
+            printf("Failed to send (%d)\n", error);
+            exit(1);
+        }
+        std::this_thread::yield();
+    }
+}
+
+// skips every packet until one of the wanted type, whose data is copied out
+static void sClientWait(BenchClient& aClient, uint16_t aType, void* aData = nullptr, size_t aDataSize = 0) {
+    uint64_t deadline = BenchNowNs() + BENCH_TIMEOUT_NS;
+    while (true) {
+        while (aClient.size >= sizeof(MPacketHeader)) {
+            MPacketHeader header;
+            memcpy(&header, aClient.buffer, sizeof(MPacketHeader));
+            size_t packetSize = sizeof(MPacketHeader) + header.dataSize + header.stringSize;
+            if (aClient.size < packetSize) { break; }
+
+            bool found = (header.packetType == aType);
+            if (found && aData) {
+                memcpy(aData, &aClient.buffer[sizeof(MPacketHeader)], (aDataSize < header.dataSize) ? aDataSize : header.dataSize);
+            }
+            memmove(aClient.buffer, &aClient.buffer[packetSize], aClient.size - packetSize);
+            aClient.size -= packetSize;
+            if (found) { return; }
+        }
+
+        int error = 0;
+        int ret = aClient.transport->Recv(&aClient.buffer[aClient.size], BENCH_CLIENT_BUFFER - aClient.size, &error);
+        if (ret > 0) { aClient.size += (size_t)ret; continue; }
+        if (ret == 0 || (error != SOCKET_EAGAIN && error != SOCKET_EWOULDBLOCK)) {
+            printf("Connection closed while waiting for packet %u (%d)\n", aType, error);
+            exit(1);
+        }
+        if (BenchNowNs() > deadline) {
+            printf("Timed out waiting for packet %u\n", aType);
+            exit(1);
+        }
+        std::this_thread::yield();
+    }
+}
+
+// opens a server connection over either an in-memory pipe or a loopback socket
+static BenchClient* sClientOpen(bool aPipe) {
+    BenchClient* client = new BenchClient();
+    if (aPipe) {
+        PipeTransport* clientEnd = nullptr;
+        PipeTransport* serverEnd = nullptr;
+        PipeTransport::Create(&clientEnd, &serverEnd);
+        client->transport = clientEnd;
+        gServer->ConnectionOpen(serverEnd);
+    } else {
+        int clientSocket = -1;
+        int serverSocket = -1;
+        if (!BenchSocketPair(&clientSocket, &serverSocket)) {
+            printf("Failed to create socket pair\n");
+            exit(1);
+        }
+        client->transport = new SocketTransport(clientSocket);
+        gServer->ConnectionOpen(new SocketTransport(serverSocket));
+    }
+
+    MPacketJoinedData joined = { 0 };
+    sClientWait(*client, MPACKET_JOINED, &joined, sizeof(joined));
+    client->id = joined.userId;
+    return client;
+}
+
+static void sClientClose(BenchClient* aClient) {
+    aClient->transport->Close();
+    delete aClient->transport;
+    delete aClient;
+}
+
+// a request answered by the server itself, the list is empty so the answer is only LIST_FINISH
+static BenchResult sBenchListRoundTrip(const char* aName, bool aPipe) {
+    BenchClient* client = sClientOpen(aPipe);
+    MPacketLobbyListGet request({}, { "bench", "" });
+    for (int i = 0; i < 100; i++) {
+        sClientSend(*client, request);
+        sClientWait(*client, MPACKET_LOBBY_LIST_FINISH);
+    }
+
+    uint64_t allocations = BenchAllocations();
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < BENCH_ROUND_TRIPS; i++) {
+        sClientSend(*client, request);
+        sClientWait(*client, MPACKET_LOBBY_LIST_FINISH);
+    }
+    uint64_t end = BenchNowNs();
+    allocations = BenchAllocations() - allocations;
+
+    sClientClose(client);
+    return {
+        .name = aName,
+        .iterations = BENCH_ROUND_TRIPS,
+        .ns = end - start,
+        .bytes = 0,
+        .allocations = allocations,
+    };
+}
+
+// a packet the server relays from one client to another
+static BenchResult sBenchSdpRelay(const char* aName, bool aPipe) {
+    BenchClient* sender = sClientOpen(aPipe);
+    BenchClient* receiver = sClientOpen(aPipe);
+    std::string sdp(600, 's');
+    MPacketPeerSdp relay({ .lobbyId = 0, .userId = receiver->id }, { sdp });
+    for (int i = 0; i < 100; i++) {
+        sClientSend(*sender, relay);
+        sClientWait(*receiver, MPACKET_PEER_SDP);
+    }
+
+    uint64_t allocations = BenchAllocations();
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < BENCH_ROUND_TRIPS; i++) {
+        sClientSend(*sender, relay);
+        sClientWait(*receiver, MPACKET_PEER_SDP);
+    }
+    uint64_t end = BenchNowNs();
+    allocations = BenchAllocations() - allocations;
+
+    sClientClose(sender);
+    sClientClose(receiver);
+    return {
+        .name = aName,
+        .iterations = BENCH_ROUND_TRIPS,
+        .ns = end - start,
+        .bytes = (uint64_t)BENCH_ROUND_TRIPS * sdp.size(),
+        .allocations = allocations,
+    };
+}
+
+int main(int argc, char* argv[]) {
+    BenchBegin(argc, argv);
+
+    // no port, so nothing listens and every connection is opened by the bench
+    gServer = new Server();
+    if (!gServer->Begin(0, 1)) {
+        printf("Failed to start server\n");
+        return 1;
+    }
+
+    BenchPrintHeader("Server round trip (per packet, one worker)");
+    BenchPrint(sBenchListRoundTrip("lobby_list_get socket", false));
+    BenchPrint(sBenchListRoundTrip("lobby_list_get pipe", true));
+    BenchPrint(sBenchSdpRelay("peer_sdp relay socket", false));
+    BenchPrint(sBenchSdpRelay("peer_sdp relay pipe", true));
+    return BenchEnd();
+}
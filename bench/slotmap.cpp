@@ -0,0 +1,90 @@
+#include <map>
+#include <vector>
+#include <random>
+#include "bench.hpp"
+#include "slotmap.hpp"
+
+#define BENCH_ENTRIES 100000
+#define BENCH_LOOKUPS 1000000
+
+static std::vector<uint64_t> sIds;
+static std::vector<SlotHandle> sHandles;
+
+// how lobbies used to be looked up
+static BenchResult sBenchMap(const char* aName) {
+    std::map<uint64_t, uint64_t> map;
+    for (auto& id : sIds) {
+        map[id] = id;
+    }
+
+    uint64_t found = 0;
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < BENCH_LOOKUPS; i++) {
+        auto it = map.find(sIds[i % BENCH_ENTRIES]);
+        if (it != map.end()) { found += it->second; }
+    }
+    uint64_t end = BenchNowNs();
+    if (found == 0) { exit(1); }
+
+    return {
+        .name = aName,
+        .iterations = BENCH_LOOKUPS,
+        .ns = end - start,
+        .bytes = 0,
+        .allocations = 0,
+    };
+}
+
+static BenchResult sBenchSlotMap(const char* aName, bool aById, bool aStale) {
+    SlotMap<uint64_t> map;
+    sHandles.clear();
+    for (auto& id : sIds) {
+        sHandles.push_back(map.Insert(id, id));
+    }
+
+    // every slot freed and taken again, the old handles must all miss
+    if (aStale) {
+        for (auto& handle : sHandles) {
+            map.Remove(handle);
+        }
+        for (auto& id : sIds) {
+            map.Insert(id, id);
+        }
+    }
+
+    uint64_t found = 0;
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < BENCH_LOOKUPS; i++) {
+        uint64_t* value = aById ? map.Find(sIds[i % BENCH_ENTRIES]) : map.Get(sHandles[i % BENCH_ENTRIES]);
+        if (value) { found += *value; }
+    }
+    uint64_t end = BenchNowNs();
+    if ((found == 0) != aStale) {
+        printf("Stale handles %s\n", aStale ? "resolved" : "missed");
+        exit(1);
+    }
+
+    return {
+        .name = aName,
+        .iterations = BENCH_LOOKUPS,
+        .ns = end - start,
+        .bytes = 0,
+        .allocations = 0,
+    };
+}
+
+int main(int argc, char* argv[]) {
+    BenchBegin(argc, argv);
+
+    std::mt19937_64 prng(1);
+    for (int i = 0; i < BENCH_ENTRIES; i++) {
+        sIds.push_back(prng() | 1);
+    }
+
+    BenchPrintHeader("Lookup (per lookup, 100k entries)");
+    BenchPrint(sBenchMap("std::map, by id"));
+    BenchPrint(sBenchSlotMap("slot map, by id", true, false));
+    BenchPrint(sBenchSlotMap("slot map, by handle", false, false));
+    BenchPrint(sBenchSlotMap("slot map, stale handle", false, true));
+    return BenchEnd();
+}
@@ -0,0 +1,88 @@
+#include <vector>
+#include "bench.hpp"
+#include "timerwheel.hpp"
+
+#define BENCH_TICKS 4000
+#define BENCH_SPREAD_SECS 240
+
+// every connection has a deadline somewhere in the next four minutes, each
+// one that fires is scheduled again, like a keep-alive would be
+static BenchResult sBenchWheel(const char* aName, int aTimers) {
+    TimerWheel wheel;
+    std::vector<TimerEntry> due;
+    uint64_t now = 1000000;
+    wheel.Begin(now);
+    for (int i = 0; i < aTimers; i++) {
+        wheel.Schedule(now + 1 + (i % BENCH_SPREAD_SECS), 0, i, 0);
+    }
+
+    uint64_t allocations = BenchAllocations();
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < BENCH_TICKS; i++) {
+        now++;
+        wheel.Advance(now, due);
+        for (auto& it : due) {
+            if (it.deadline != now) {
+                printf("Timer fired at %" PRIu64 " instead of %" PRIu64 "\n", now, it.deadline);
+                exit(1);
+            }
+            wheel.Schedule(now + BENCH_SPREAD_SECS, it.type, it.id, it.arg);
+        }
+        due.clear();
+    }
+    uint64_t end = BenchNowNs();
+    allocations = BenchAllocations() - allocations;
+
+    if (wheel.Count() != (size_t)aTimers) {
+        printf("Lost timers: %" PRIu64 " != %d\n", (uint64_t)wheel.Count(), aTimers);
+        exit(1);
+    }
+
+    return {
+        .name = aName,
+        .iterations = BENCH_TICKS,
+        .ns = end - start,
+        .bytes = 0,
+        .allocations = allocations,
+    };
+}
+
+// what every tick used to cost, looking at each connection's deadline
+static BenchResult sBenchScan(const char* aName, int aTimers) {
+    std::vector<uint64_t> deadlines;
+    uint64_t now = 1000000;
+    for (int i = 0; i < aTimers; i++) {
+        deadlines.push_back(now + 1 + (i % BENCH_SPREAD_SECS));
+    }
+
+    int ticks = BENCH_TICKS / 10;
+    uint64_t start = BenchNowNs();
+    for (int i = 0; i < ticks; i++) {
+        now++;
+        for (auto& it : deadlines) {
+            if (it > now) { continue; }
+            it = now + BENCH_SPREAD_SECS;
+        }
+    }
+    uint64_t end = BenchNowNs();
+
+    return {
+        .name = aName,
+        .iterations = (uint64_t)ticks,
+        .ns = end - start,
+        .bytes = 0,
+        .allocations = 0,
+    };
+}
+
+int main(int argc, char* argv[]) {
+    BenchBegin(argc, argv);
+    BenchPrintHeader("Timer tick (per one second tick, 1/240th of the timers due)");
+    BenchPrint(sBenchScan("10k connections (scan)", 10000));
+    BenchPrint(sBenchWheel("10k timers", 10000));
+    BenchPrint(sBenchScan("100k connections (scan)", 100000));
+    BenchPrint(sBenchWheel("100k timers", 100000));
+    BenchPrint(sBenchScan("1M connections (scan)", 1000000));
+    BenchPrint(sBenchWheel("1M timers", 1000000));
+    return BenchEnd();
+}
@@ -0,0 +1,102 @@
+#include <cinttypes>
+#include "admission.hpp"
+#include "connection.hpp"
+#include "libcoopnet.h"
+#include "logging.hpp"
+
+static void sAdmissionStart(Admission* admission) { admission->Run(); }
+
+bool Admission::Begin(uint32_t aThreads, AdmissionDone aDone, AdmissionRecheckDone aRecheckDone) {
+    mDone = aDone;
+    mRecheckDone = aRecheckDone;
+    if (aThreads == 0) { aThreads = 1; }
+    for (uint32_t i = 0; i < aThreads; i++) {
+        std::thread thread(sAdmissionStart, this);
+        thread.detach();
+    }
+    return true;
+}
+
+bool Admission::Push(Connection* aConnection) {
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        if (mQueue.size() >= ADMISSION_MAX_PENDING) {
+            LOG_ERROR("[%" PRIu64 "] Too many connections waiting to be checked, dropping it", aConnection->mId);
+            return false;
+        }
+        mQueue.push_back(aConnection);
+        mPending.Insert(aConnection->mId, false);
+    }
+    mReady.notify_one();
+    return true;
+}
+
+void Admission::Recheck(Connection* aConnection) {
+    // never dropped, a connection that's already in shouldn't escape a ban
+    // just because a lot of others are being looked at
+    aConnection->mRechecks++;
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mRecheckQueue.push_back(aConnection);
+    }
+    mReady.notify_one();
+}
+
+bool Admission::Pending(uint64_t aConnectionId) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mPending.Contains(aConnectionId);
+}
+
+bool Admission::Ban(uint64_t aConnectionId) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    bool* banned = mPending.Find(aConnectionId);
+    if (!banned) { return false; }
+    *banned = true;
+    return true;
+}
+
+bool Admission::Release(uint64_t aConnectionId) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    bool* banned = mPending.Find(aConnectionId);
+    if (!banned) { return false; }
+    bool wasBanned = *banned;
+    mPending.Erase(aConnectionId);
+    return wasBanned;
+}
+
+size_t Admission::Count() {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mPending.Size();
+}
+
+void Admission::Run() {
+    while (true) {
+        Connection* connection = nullptr;
+        bool isNew = true;
+        {
+            // new connections are waiting to be let in, so they go first
+            std::unique_lock<std::mutex> lock(mMutex);
+            mReady.wait(lock, [this]() { return !mQueue.empty() || !mRecheckQueue.empty(); });
+            if (!mQueue.empty()) {
+                connection = mQueue.front();
+                mQueue.pop_front();
+            } else {
+                connection = mRecheckQueue.front();
+                mRecheckQueue.pop_front();
+                isNew = false;
+            }
+        }
+
+        // the slow part, nothing else is held while it runs
+        bool allowed = !gCoopNetCallbacks.ConnectionIsAllowed || gCoopNetCallbacks.ConnectionIsAllowed(connection, isNew);
+        if (isNew) {
+            mDone(connection, allowed);
+            continue;
+        }
+
+        // the owning worker may free it as soon as it's let go
+        uint64_t id = connection->mId;
+        connection->mRechecks--;
+        mRecheckDone(id, allowed);
+    }
+}
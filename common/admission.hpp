@@ -0,0 +1,46 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <cstdint>
+#include "flatmap.hpp"
+
+class Connection;
+
+#define ADMISSION_DEFAULT_THREADS 4
+#define ADMISSION_MAX_PENDING 4096
+
+typedef std::function<void(Connection* aConnection, bool aAllowed)> AdmissionDone;
+typedef std::function<void(uint64_t aConnectionId, bool aAllowed)> AdmissionRecheckDone;
+
+// Runs the ConnectionIsAllowed check for new connections on its own threads,
+// so a slow ban lookup never holds up accept().
+// Connections wait here unread until their check completes, then they're
+// handed to aDone which finishes opening them or turns them away.
+// aDone has to Release() the connection once it's been handed over.
+// Connections that are already open get checked again here after a ban change,
+// aRecheckDone only learns the id since the connection may be gone by then.
+class Admission {
+    private:
+        std::mutex mMutex;
+        std::condition_variable mReady;
+        std::deque<Connection*> mQueue;
+        std::deque<Connection*> mRecheckQueue;
+        // true once the connection was banned while it waited
+        FlatMap<bool> mPending;
+        AdmissionDone mDone;
+        AdmissionRecheckDone mRecheckDone;
+
+    public:
+        bool Begin(uint32_t aThreads, AdmissionDone aDone, AdmissionRecheckDone aRecheckDone);
+        void Run();
+        bool Push(Connection* aConnection);
+        void Recheck(Connection* aConnection);
+        bool Pending(uint64_t aConnectionId);
+        bool Ban(uint64_t aConnectionId);
+        bool Release(uint64_t aConnectionId);
+        size_t Count();
+};
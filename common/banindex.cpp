@@ -0,0 +1,46 @@
+#include <algorithm>
+#include "banindex.hpp"
+
+void BanIndex::Insert(enum BanKey aKey, uint64_t aValue, uint64_t aConnectionId) {
+    // zero means not known (yet), nobody bans that and it would gather everyone
+    if (aValue == 0) { return; }
+    std::vector<uint64_t>* ids = mKeys[aKey].Find(aValue);
+    if (!ids) { ids = mKeys[aKey].Insert(aValue, std::vector<uint64_t>()); }
+    ids->push_back(aConnectionId);
+}
+
+void BanIndex::Erase(enum BanKey aKey, uint64_t aValue, uint64_t aConnectionId) {
+    std::vector<uint64_t>* ids = mKeys[aKey].Find(aValue);
+    if (!ids) { return; }
+
+    // hardly ever more than a couple of connections share a key
+    ids->erase(std::remove(ids->begin(), ids->end(), aConnectionId), ids->end());
+    if (ids->empty()) { mKeys[aKey].Erase(aValue); }
+}
+
+void BanIndex::Add(uint64_t aConnectionId, uint64_t aAddress, uint64_t aDestId) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    Insert(BAN_KEY_ADDRESS, aAddress, aConnectionId);
+    Insert(BAN_KEY_DEST_ID, aDestId, aConnectionId);
+}
+
+void BanIndex::Remove(uint64_t aConnectionId, uint64_t aAddress, uint64_t aDestId, uint64_t aInfoBits) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    Erase(BAN_KEY_ADDRESS, aAddress, aConnectionId);
+    Erase(BAN_KEY_DEST_ID, aDestId, aConnectionId);
+    Erase(BAN_KEY_INFO_BITS, aInfoBits, aConnectionId);
+}
+
+void BanIndex::Move(enum BanKey aKey, uint64_t aConnectionId, uint64_t aFrom, uint64_t aTo) {
+    if (aFrom == aTo) { return; }
+    std::lock_guard<std::mutex> guard(mMutex);
+    Erase(aKey, aFrom, aConnectionId);
+    Insert(aKey, aTo, aConnectionId);
+}
+
+void BanIndex::Find(enum BanKey aKey, uint64_t aValue, std::vector<uint64_t>& aConnectionIds) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    std::vector<uint64_t>* ids = mKeys[aKey].Find(aValue);
+    if (!ids) { return; }
+    aConnectionIds.insert(aConnectionIds.end(), ids->begin(), ids->end());
+}
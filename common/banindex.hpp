@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <mutex>
+#include "flatmap.hpp"
+
+enum BanKey {
+    BAN_KEY_ADDRESS,
+    BAN_KEY_DEST_ID,
+    BAN_KEY_INFO_BITS,
+    BAN_KEY_MAX,
+};
+
+// Live connection ids by everything a ban can name: the IPv4 address, the
+// destination id and the info bits. A ban then only has to look up the
+// connections it names instead of asking about every connection.
+// Info bits are added with Move() once the client sends them.
+// Has its own mutex, it's touched from the accept, admission and worker threads.
+class BanIndex {
+    private:
+        FlatMap<std::vector<uint64_t>> mKeys[BAN_KEY_MAX];
+        std::mutex mMutex;
+
+        void Insert(enum BanKey aKey, uint64_t aValue, uint64_t aConnectionId);
+        void Erase(enum BanKey aKey, uint64_t aValue, uint64_t aConnectionId);
+
+    public:
+        void Add(uint64_t aConnectionId, uint64_t aAddress, uint64_t aDestId);
+        void Remove(uint64_t aConnectionId, uint64_t aAddress, uint64_t aDestId, uint64_t aInfoBits);
+        void Move(enum BanKey aKey, uint64_t aConnectionId, uint64_t aFrom, uint64_t aTo);
+        void Find(enum BanKey aKey, uint64_t aValue, std::vector<uint64_t>& aConnectionIds);
+};
@@ -2,6 +2,7 @@
 #include "mpacket.hpp"
 #include "utils.hpp"
 #include "logging.hpp"
+#include "coarseclock.hpp"
 
 Client* gClient = NULL;
 
@@ -23,8 +24,8 @@ bool Client::Begin(std::string aHost, uint32_t aPort, std::string aName, uint64_
     mStunServer.port = 19302;
 
     // setup a socket
-    mConnection->mSocket = SocketInitialize(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if(mConnection->mSocket <= 0)
+    int sock = SocketInitialize(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if(sock <= 0)
     {
         LOG_ERROR("Socket failed");
         return false;
@@ -35,10 +36,10 @@ bool Client::Begin(std::string aHost, uint32_t aPort, std::string aName, uint64_
     mConnection->mAddress.sin_addr.s_addr = GetAddrFromDomain(aHost);
     mConnection->mAddress.sin_port = htons(aPort);
 
-    SocketSetOptions(mConnection->mSocket);
+    SocketSetOptions(sock);
     errno = 0;
 
-    int rc = connect(mConnection->mSocket, (struct sockaddr*) &mConnection->mAddress, sizeof(struct sockaddr_in));
+    int rc = connect(sock, (struct sockaddr*) &mConnection->mAddress, sizeof(struct sockaddr_in));
     if (rc < 0) {
         rc = errno;
         if (rc == EINPROGRESS || rc == 0) {
@@ -50,32 +51,33 @@ bool Client::Begin(std::string aHost, uint32_t aPort, std::string aName, uint64_
             // Setup the file descriptors to watch for write readiness
             fd_set writeSet;
             FD_ZERO(&writeSet);
-            FD_SET(mConnection->mSocket, &writeSet);
+            FD_SET(sock, &writeSet);
 
             // Use select to wait for the socket to become writable or timeout
-            int selectResult = select(mConnection->mSocket + 1, nullptr, &writeSet, nullptr, &timeout);
+            int selectResult = select(sock + 1, nullptr, &writeSet, nullptr, &timeout);
             if (selectResult == 0) {
                 LOG_ERROR("Connection timed out");
-                SocketClose(mConnection->mSocket);
+                SocketClose(sock);
                 return false;
             } else if (selectResult < 0) {
                 LOG_ERROR("Error while waiting for connection");
-                SocketClose(mConnection->mSocket);
+                SocketClose(sock);
                 return false;
             }
         } else {
             // Other error occurred during connect
             LOG_ERROR("Connect failed: %u", rc);
-            SocketClose(mConnection->mSocket);
+            SocketClose(sock);
             return false;
         }
     }
 
+    mConnection->mTransport = new SocketTransport(sock);
     mConnection->Begin(nullptr);
 
     MPacketInfo({
         .destId = aDestId,
-        .infoBits = SocketGetInfoBits(mConnection->mSocket),
+        .infoBits = SocketGetInfoBits(sock),
         .hash = hashFile(),
     }, { aName }).Send(*mConnection);
 
@@ -87,6 +89,10 @@ void Client::Update() {
     if (mUpdating) { return; }
     mUpdating = true;
 
+    // everything below reads the time from here
+    CoarseClockUpdate();
+
+    mConnection->Flush();
     mConnection->Receive();
     mConnection->Update();
 
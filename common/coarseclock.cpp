@@ -0,0 +1,39 @@
+#include <atomic>
+#include <chrono>
+#include "coarseclock.hpp"
+
+static std::atomic<uint64_t> sNow(0);
+static std::atomic<uint64_t> sMonotonicNs(0);
+
+// several threads update it, never let it go backwards
+static void sStoreMax(std::atomic<uint64_t>& aValue, uint64_t aNew) {
+    uint64_t current = aValue.load(std::memory_order_relaxed);
+    while (current < aNew && !aValue.compare_exchange_weak(current, aNew, std::memory_order_relaxed)) {}
+}
+
+void CoarseClockUpdate() {
+    std::chrono::system_clock::time_point nowTp = std::chrono::system_clock::now();
+    sStoreMax(sNow, (uint64_t)std::chrono::system_clock::to_time_t(nowTp));
+
+    std::chrono::steady_clock::duration monotonic = std::chrono::steady_clock::now().time_since_epoch();
+    sStoreMax(sMonotonicNs, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(monotonic).count());
+}
+
+uint64_t CoarseClockNow() {
+    uint64_t now = sNow.load(std::memory_order_relaxed);
+    if (now == 0) {
+        // read before any loop got going
+        CoarseClockUpdate();
+        now = sNow.load(std::memory_order_relaxed);
+    }
+    return now;
+}
+
+uint64_t CoarseClockMonotonicNs() {
+    uint64_t now = sMonotonicNs.load(std::memory_order_relaxed);
+    if (now == 0) {
+        CoarseClockUpdate();
+        now = sMonotonicNs.load(std::memory_order_relaxed);
+    }
+    return now;
+}
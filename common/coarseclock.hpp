@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+// A clock that only asks the system for the time when it's told to.
+// The event loops call CoarseClockUpdate() once per iteration, everything
+// else reads the cached values, so a packet costs no clock call at all.
+// Good to about a second on an idle server, which is all the keep-alive,
+// timeout and reputation bookkeeping needs. Measure latencies with a real clock.
+void CoarseClockUpdate();
+
+// wall clock, seconds since the epoch
+uint64_t CoarseClockNow();
+
+// monotonic, nanoseconds from some fixed point
+uint64_t CoarseClockMonotonicNs();
@@ -1,4 +1,6 @@
 #include <cstdint>
+#include <cstring>
+#include <new>
 #include <string>
 #include <set>
 #include <functional>
@@ -11,12 +13,44 @@
 #include "mpacket.hpp"
 #include "peer.hpp"
 #include "server.hpp"
+#include "reactor.hpp"
+#include "worker.hpp"
+#include "slabpool.hpp"
+#include "connectiontable.hpp"
+#include "coarseclock.hpp"
+
+// never destroyed, workers may still be freeing connections while the process exits
+static SlabPool* sConnectionPool() {
+    static SlabPool* sPool = new SlabPool(sizeof(Connection), CONNECTION_POOL_SLAB);
+    return sPool;
+}
+
+static SlabPool* sBufferPool() {
+    static SlabPool* sPool = new SlabPool(MPACKET_MAX_SIZE, CONNECTION_BUFFER_POOL_SLAB);
+    return sPool;
+}
+
+// where whole packets are read when the connection has nothing left over,
+// it's only used until Receive() returns so one per thread is enough
+static thread_local uint8_t sReceiveScratch[MPACKET_MAX_SIZE];
+
+void* Connection::operator new(size_t aSize) {
+    void* ptr = sConnectionPool()->Alloc();
+    if (!ptr) { throw std::bad_alloc(); }
+    return ptr;
+}
+
+void Connection::operator delete(void* aPtr) {
+    sConnectionPool()->Free(aPtr);
+}
 
 Connection::Connection(uint64_t id) {
     mId = id;
 }
 
 Connection::~Connection() {
+    sBufferPool()->Free(mData);
+    delete mTransport;
 }
 
 void Connection::Begin(uint64_t (*aDestIdFunction)(uint64_t aInput)) {
@@ -24,16 +58,12 @@ void Connection::Begin(uint64_t (*aDestIdFunction)(uint64_t aInput)) {
     mActive = true;
 
     // get destination id
-    struct sockaddr_in addr = { 0 };
-    socklen_t len = sizeof(addr);
-    getpeername(mSocket, (struct sockaddr*)&addr, &len);
-    uint64_t addr64 = (uint64_t)addr.sin_addr.s_addr;
+    uint64_t addr64 = mTransport->Address();
     mDestinationId = (aDestIdFunction)
         ? aDestIdFunction(addr64)
         : 0;
 
-    // set socket to non-blocking mode
-    SocketSetOptions(mSocket);
+    mTransport->Begin();
 
     // convert address
     char asciiAddress[256] = { 0 };
@@ -41,8 +71,7 @@ void Connection::Begin(uint64_t (*aDestIdFunction)(uint64_t aInput)) {
     mAddressStr = asciiAddress;
 
     // don't send a keep-alive packet immediately
-    std::chrono::system_clock::time_point nowTp = std::chrono::system_clock::now();
-    uint64_t now = std::chrono::system_clock::to_time_t(nowTp);
+    uint64_t now = CoarseClockNow();
     mLastSendTime = now;
     mLastReceiveTime = now;
 
@@ -52,12 +81,33 @@ void Connection::Begin(uint64_t (*aDestIdFunction)(uint64_t aInput)) {
 void Connection::Disconnect(bool aIntentional) {
     if (!mActive) { return; }
 
+    // lobbies are shared between the server workers
+    std::unique_lock<std::recursive_mutex> lobbyGuard;
+    if (gServer) {
+        lobbyGuard = std::unique_lock<std::recursive_mutex>(gServer->mLobbiesMutex);
+    }
+
     if (mLobby) {
         mLobby->Leave(this);
     }
 
     mActive = false;
-    SocketClose(mSocket);
+    if (mTable) {
+        mTable->SetActive(mSlot, false);
+    }
+    if (gServer) {
+        gServer->ConnectionForget(this);
+    }
+    if (mReactor) {
+        mReactor->Remove(mTransport->Socket());
+        mReactor = nullptr;
+    }
+    mTransport->Close();
+
+    // let the owning worker know it can free this connection
+    if (mWorker) {
+        mWorker->Release(mId);
+    }
 
     if (gCoopNetCallbacks.OnDisconnected) {
         gCoopNetCallbacks.OnDisconnected(aIntentional);
@@ -65,106 +115,253 @@ void Connection::Disconnect(bool aIntentional) {
 }
 
 void Connection::Update() {
+    // finish an eviction that happened while sending
+    if (mEvicted) {
+        Disconnect(false);
+        return;
+    }
+
     // send a packet with no important informations every 3 minutes,
     // just to keep the connection alive
-    std::chrono::system_clock::time_point nowTp = std::chrono::system_clock::now();
-    uint64_t now = std::chrono::system_clock::to_time_t(nowTp);
-    if ((mLastSendTime + CONNECTION_KEEP_ALIVE_SECS) < now) {
+    uint64_t now = CoarseClockNow();
+    if ((LastSendTime() + CONNECTION_KEEP_ALIVE_SECS) < now) {
         MPacketKeepAlive({ 0 }).Send(*this);
     }
+}
+
+void Connection::Receive() {
+    // the server waits on edge-triggered sockets, so keep reading until
+    // the socket would block or the connection goes away
+    while (mActive) {
+        // check buffer size
+        int64_t remaining = (int64_t)MPACKET_MAX_SIZE - (int64_t)mDataSize;
+        if (remaining <= 0) {
+            LOG_ERROR("[%" PRIu64 "] Receive buffer full %" PRId64 "", mId, remaining);
+            Disconnect(false);
+            return;
+        }
+
+        // receive from the transport
+        uint8_t* data = mData ? mData : sReceiveScratch;
+        int rc = 0;
+        int ret = mTransport->Recv(&data[mDataSize], (size_t)remaining, &rc);
+        /*if ((ret != -1) || (rc != SOCKET_EAGAIN && rc != SOCKET_EWOULDBLOCK)) {
+            LOG_INFO("RECV: %d, %d, %" PRId64 ", %" PRId64, ret, rc, remaining, mDataSize);
+        }*/
+
+        // make sure connection is still active
+        if (!mActive) { return; }
+
+        // check for error
+        if ((ret == -1) && (rc == SOCKET_EAGAIN || rc == SOCKET_EWOULDBLOCK)) {
+            //LOG_INFO("[%" PRIu64 "] continue", mId);
+            return;
+        } else if (ret == 0 || (rc == SOCKET_ECONNRESET)) {
+            LOG_INFO("[%" PRIu64 "] Connection closed (%d, %d).", mId, ret, rc);
+            Disconnect(false);
+            return;
+        } else if (ret < 0) {
+            LOG_ERROR("[%" PRIu64 "] Error receiving data (%d)!", mId, rc);
+            Disconnect(false);
+            return;
+        }
+
+        /*LOG_INFO("[%" PRIu64 "] Received data:", mId);
+        for (size_t i = 0; i < (size_t)ret; i++) {
+            printf("  %02X", data[i]);
+        }
+        printf("\n");*/
 
-    // check up on peers
-    if (mActive && gServer) {
-        if (!mLobby) {
-            mPeerTimeouts.clear();
-        } else {
-            for (auto it = mPeerTimeouts.begin(); it != mPeerTimeouts.end();) {
-                uint64_t peerId = it->first;
-                uint64_t timeout = it->second;
-                if (now <= timeout) { ++it; continue; }
-                it = mPeerTimeouts.erase(it);
-
-                Connection* other = gServer->ConnectionGet(peerId);
-                if (!other || !other->mActive) { continue; }
-                if (!mLobby || mLobby != other->mLobby) { continue; }
-                gServer->ReputationIncrease(mDestinationId);
+        if (ret > 0) {
+            uint64_t now = CoarseClockNow();
+            if (mTable) {
+                mTable->SetLastReceiveTime(mSlot, now);
+            } else {
+                mLastReceiveTime = now;
             }
         }
+
+        mDataSize += ret;
+        MPacket::Read(this, data, &mDataSize, MPACKET_MAX_SIZE);
+
+        // borrow a buffer to keep a partial packet in, and give it back once it's whole
+        if (mDataSize > 0 && !mData) {
+            mData = (uint8_t*)sBufferPool()->Alloc();
+            if (!mData) {
+                Disconnect(false);
+                return;
+            }
+            memcpy(mData, sReceiveScratch, (size_t)mDataSize);
+        } else if (mDataSize == 0 && mData) {
+            sBufferPool()->Free(mData);
+            mData = nullptr;
+        }
     }
 }
 
-void Connection::Receive() {
-    // check buffer size
-    int64_t remaining = (int64_t)MPACKET_MAX_SIZE - (int64_t)mDataSize;
-    if (remaining <= 0) {
-        LOG_ERROR("[%" PRIu64 "] Receive buffer full %" PRId64 "", mId, remaining);
-        Disconnect(false);
+void Connection::Send(const uint8_t* aData, int64_t aDataSize, bool aBulk) {
+    std::lock_guard<std::mutex> guard(mOutboundMutex);
+
+    // make sure its connected
+    if (!mActive || mEvicted) {
         return;
     }
 
-    // limit the buffer to the available amount
-    SocketLimitBuffer(mSocket, &remaining);
+    // only write directly when nothing is waiting, otherwise the stream would be reordered
+    if (mOutbound.Size() == 0) {
+        int rc = 0;
+        int sent = mTransport->Send(aData, (size_t)aDataSize, &rc);
+        //LOG_INFO("SENT: %d, %d, %" PRId64 "", sent, rc, aDataSize);
 
-#ifdef OSX_BUILD
-    // OSX seems to return errno 0, size 0 on recv() when there is nothing to receive.
-    // This causes the socket to think the connection is closed...
-    // So instead, we'll just not call it if there is no data available.
-    // The side effect of this is that we will not detect connection drops very quickly.
-    if (remaining <= 0) { return; }
-#endif
+        // debug print packet
+        /*LOG_INFO("Sent data:");
+        for (size_t i = 0; i < aDataSize; i++) {
+            printf("  %02X", aData[i]);
+        }
+        printf("\n");*/
 
-    // receive from socket
-    SOCKET_RESET_ERROR();
-    int ret = recv(mSocket, (char*)&mData[mDataSize], (size_t)remaining, MSG_DONTWAIT);
-    int rc = SOCKET_LAST_ERROR;
-    /*if ((ret != -1) || (rc != SOCKET_EAGAIN && rc != SOCKET_EWOULDBLOCK)) {
-        LOG_INFO("RECV: %d, %d, %" PRId64 ", %" PRId64, ret, rc, remaining, mDataSize);
-    }*/
+        if (sent < 0) {
+            if (rc != SOCKET_EAGAIN && rc != SOCKET_EWOULDBLOCK) {
+                LOG_ERROR("[%" PRIu64 "] Error sending data (%d)!", mId, rc);
+                Evict("send error");
+                return;
+            }
+            sent = 0;
+        }
 
-    // make sure connection is still active
-    if (!mActive) { return; }
+        aData += sent;
+        aDataSize -= sent;
+    }
 
-    // check for error
-    if ((ret == -1) && (rc == SOCKET_EAGAIN || rc == SOCKET_EWOULDBLOCK)) {
-        //LOG_INFO("[%" PRIu64 "] continue", mId);
-        return;
-    } else if (ret == 0 || (rc == SOCKET_ECONNRESET)) {
-        LOG_INFO("[%" PRIu64 "] Connection closed (%d, %d).", mId, ret, rc);
-        Disconnect(false);
-        return;
-    } else if (ret < 0) {
-        LOG_ERROR("[%" PRIu64 "] Error receiving data (%d)!", mId, rc);
-        Disconnect(false);
-        return;
+    // queue whatever the socket didn't take
+    if (aDataSize > 0) {
+        // one bulk response at a time gets room on top of the budget until it
+        // has gone out, a client that keeps asking without reading is still dropped
+        if (aBulk && mBulkAllowance == 0) {
+            mBulkAllowance = (size_t)aDataSize;
+        }
+        if (mOutbound.Size() + (size_t)aDataSize > CONNECTION_OUTBOUND_BUDGET + mBulkAllowance) {
+            Evict("outbound budget exceeded");
+            return;
+        }
+        if (!mOutbound.Write(aData, (size_t)aDataSize)) {
+            // dropping part of the stream would desync the client
+            Evict("outbound allocation failed");
+            return;
+        }
+        ArmWrite(true);
     }
 
-    /*LOG_INFO("[%" PRIu64 "] Received data:", mId);
-    for (size_t i = 0; i < (size_t)ret; i++) {
-        printf("  %02X", data[i]);
+    // update last send time
+    uint64_t now = CoarseClockNow();
+    if (mTable) {
+        mTable->SetLastSendTime(mSlot, now);
+    } else {
+        mLastSendTime = now;
     }
-    printf("\n");*/
+}
+
+uint64_t Connection::LastSendTime() {
+    return mTable ? mTable->LastSendTime(mSlot) : mLastSendTime;
+}
+
+uint64_t Connection::LastReceiveTime() {
+    return mTable ? mTable->LastReceiveTime(mSlot) : mLastReceiveTime;
+}
+
+bool Connection::Evicted() {
+    return mEvicted;
+}
+
+ConnectionRef Connection::Ref() {
+    return { mId, mTable, mHandle };
+}
 
-    if (ret > 0) {
-        std::chrono::system_clock::time_point nowTp = std::chrono::system_clock::now();
-        uint64_t now = std::chrono::system_clock::to_time_t(nowTp);
-        mLastReceiveTime = now;
+void Connection::Flush() {
+    std::lock_guard<std::mutex> guard(mOutboundMutex);
+    if (!mActive || mEvicted) { return; }
+
+    while (mOutbound.Size() > 0) {
+        const uint8_t* data = nullptr;
+        size_t dataSize = mOutbound.Peek(&data);
+
+        int rc = 0;
+        int sent = mTransport->Send(data, dataSize, &rc);
+
+        if (sent < 0) {
+            if (rc == SOCKET_EAGAIN || rc == SOCKET_EWOULDBLOCK) {
+                // wait for the socket to become writable again
+                ArmWrite(true);
+                return;
+            }
+            LOG_ERROR("[%" PRIu64 "] Error flushing data (%d)!", mId, rc);
+            Evict("flush error");
+            return;
+        }
+
+        mOutbound.Consume((size_t)sent);
     }
 
-    mDataSize += ret;
-    MPacket::Read(this, mData, &mDataSize, MPACKET_MAX_SIZE);
+    mBulkAllowance = 0;
+    ArmWrite(false);
+}
+
+void Connection::ArmWrite(bool aArm) {
+    // without a reactor the owner polls Flush() instead
+    if (!mReactor || mWriteArmed == aArm) { return; }
+    mWriteArmed = aArm;
+    mReactor->Modify(mTransport->Socket(), mHandle, aArm ? (REACTOR_READ | REACTOR_WRITE) : REACTOR_READ);
+}
+
+void Connection::Evict(const char* aReason) {
+    // can't disconnect in here, a lobby broadcast might be iterating over us
+    LOG_ERROR("[%" PRIu64 "] Evicting connection: %s (%" PRIu64 " bytes queued)", mId, aReason, (uint64_t)mOutbound.Size());
+    mEvicted = true;
+    mOutbound.Clear();
+
+    // one without a worker yet is disconnected as soon as it's adopted
+    if (gServer && mWorker) {
+        gServer->QueueDisconnect(mId);
+    }
 }
 
 void Connection::PeerBegin(uint64_t aPeerId) {
-    if (mPeerTimeouts.count(aPeerId) > 0) { return; }
+    std::lock_guard<std::mutex> guard(mPeerTimeoutsMutex);
+    if (mPeerTimeouts.Contains(aPeerId)) { return; }
     if (aPeerId == mDestinationId) { return; }
-    std::chrono::system_clock::time_point nowTp = std::chrono::system_clock::now();
-    uint64_t now = std::chrono::system_clock::to_time_t(nowTp);
-    mPeerTimeouts[aPeerId] = now + PEER_TIMEOUT * 2;
+    uint64_t now = CoarseClockNow();
+    uint64_t timeout = now + PEER_TIMEOUT * 2;
+    mPeerTimeouts.Insert(aPeerId, timeout);
+
+    // peers are only started by the owning worker, which checks on them once they time out
+    if (mWorker && mWorker == Worker::Current()) {
+        mWorker->TimerSchedule(timeout + 1, WORKER_TIMER_PEER, mHandle, aPeerId);
+    }
+}
+
+void Connection::PeerTimeout(uint64_t aPeerId, uint64_t aNow) {
+    {
+        std::lock_guard<std::mutex> guard(mPeerTimeoutsMutex);
+        uint64_t* timeout = mPeerTimeouts.Find(aPeerId);
+        if (!timeout) { return; }
+
+        // the peer was started again after this timer
+        if (aNow <= *timeout) { return; }
+        mPeerTimeouts.Erase(aPeerId);
+    }
+
+    // a peer that made it this far without failing earns some reputation
+    if (!gServer || !mActive || !mLobby) { return; }
+    Connection* other = gServer->ConnectionGet(aPeerId);
+    if (!other || !other->mActive) { return; }
+    if (mLobby != other->mLobby) { return; }
+    gServer->ReputationIncrease(mDestinationId);
 }
 
 void Connection::PeerFail(uint64_t aPeerId) {
-    if (mPeerTimeouts.count(aPeerId) > 0) {
-        mPeerTimeouts.erase(aPeerId);
+    {
+        std::lock_guard<std::mutex> guard(mPeerTimeoutsMutex);
+        mPeerTimeouts.Erase(aPeerId);
     }
     if (gServer && mActive) {
         Connection* other = gServer->ConnectionGet(aPeerId);
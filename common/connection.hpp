@@ -4,18 +4,49 @@
 #include "socket.hpp"
 #include "mpacket.hpp"
 #include "lobby.hpp"
+#include "ringbuffer.hpp"
+#include "transport.hpp"
+#include "slotmap.hpp"
+#include "flatmap.hpp"
+#include "connectiontable.hpp"
 #include <map>
+#include <mutex>
+#include <atomic>
 
 class Lobby;
+class Reactor;
+class Worker;
+class ConnectionTable;
 
 #define CONNECTION_KEEP_ALIVE_SECS (60 * 3)
 #define CONNECTION_DEAD_SECS (60 * 4)
 
+// a client that lets this much unsent data pile up is dropped,
+// a bulk response like a lobby list gets its own size on top while it drains
+#define CONNECTION_OUTBOUND_BUDGET (512 * 1024)
+
+// connections and receive buffers are carved out of slabs this many at a time
+#define CONNECTION_POOL_SLAB 256
+#define CONNECTION_BUFFER_POOL_SLAB 16
+
 class Connection {
     private:
-        uint8_t mData[MPACKET_MAX_SIZE] = { 0 };
+        // only held while part of a packet is waiting for the rest
+        uint8_t* mData = nullptr;
         int64_t mDataSize = 0;
-        std::map<uint64_t, uint64_t> mPeerTimeouts;
+        FlatMap<uint64_t> mPeerTimeouts;
+        std::mutex mPeerTimeoutsMutex;
+        RingBuffer mOutbound;
+        size_t mBulkAllowance = 0;
+        std::mutex mOutboundMutex;
+        bool mWriteArmed = false;
+        bool mEvicted = false;
+        // only used until a worker adopts this connection, then the times live in its table
+        uint64_t mLastSendTime = 0;
+        uint64_t mLastReceiveTime = 0;
+
+        void ArmWrite(bool aArm);
+        void Evict(const char* aReason);
 
     public:
         bool mActive = false;
@@ -24,22 +55,37 @@ class Connection {
         uint64_t mDestinationId = 0;
         uint64_t mInfoBits = 0;
         bool mUpdated = false;
-        int mSocket = 0;
+        Transport* mTransport = nullptr;
         struct sockaddr_in mAddress = { 0};
         Lobby* mLobby = nullptr;
+        Reactor* mReactor = nullptr;
+        Worker* mWorker = nullptr;
         uint32_t mPriority = 0;
-        uint64_t mLastSendTime = 0;
-        uint64_t mLastReceiveTime = 0;
+        ConnectionTable* mTable = nullptr;
+        uint32_t mSlot = 0;
+        // what the owning worker's timers and socket events refer to this connection by
+        SlotHandle mHandle = 0;
         std::string mAddressStr;
         uint64_t mHash;
+        // ban checks still reading this connection, it isn't freed until they're done
+        std::atomic<uint32_t> mRechecks { 0 };
 
         Connection(uint64_t id);
         ~Connection();
+        static void* operator new(size_t aSize);
+        static void operator delete(void* aPtr);
         void Begin(uint64_t (*aDestIdFunction)(uint64_t aInput));
         void Disconnect(bool aIntentional);
         void Update();
         void Receive();
+        void Send(const uint8_t* aData, int64_t aDataSize, bool aBulk = false);
+        void Flush();
+        uint64_t LastSendTime();
+        uint64_t LastReceiveTime();
+        bool Evicted();
+        ConnectionRef Ref();
 
         void PeerBegin(uint64_t aPeerId);
         void PeerFail(uint64_t aPeerId);
+        void PeerTimeout(uint64_t aPeerId, uint64_t aNow);
 };
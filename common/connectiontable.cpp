@@ -0,0 +1,69 @@
+#include "connectiontable.hpp"
+#include "connection.hpp"
+
+void ConnectionTable::Add(Connection* aConnection) {
+    uint32_t slot = (uint32_t)mIds.size();
+    mIds.push_back(aConnection->mId);
+    mActive.push_back(aConnection->mActive ? 1 : 0);
+    mLastSendTimes.push_back(aConnection->LastSendTime());
+    mLastReceiveTimes.push_back(aConnection->LastReceiveTime());
+    mConnections.push_back(aConnection);
+    mHandles.push_back(mSlots.Insert(aConnection->mId, slot));
+
+    // from here on the connection keeps its times in the table
+    aConnection->mHandle = mHandles.back();
+    aConnection->mSlot = slot;
+    aConnection->mTable = this;
+}
+
+void ConnectionTable::Remove(uint32_t aSlot) {
+    Connection* connection = mConnections[aSlot];
+    mSlots.Remove(mHandles[aSlot]);
+    connection->mHandle = 0;
+    connection->mTable = nullptr;
+
+    // fill the hole with the last connection
+    uint32_t last = (uint32_t)mIds.size() - 1;
+    if (aSlot != last) {
+        mIds[aSlot] = mIds[last];
+        mActive[aSlot] = mActive[last];
+        mLastSendTimes[aSlot] = mLastSendTimes[last];
+        mLastReceiveTimes[aSlot] = mLastReceiveTimes[last];
+        mConnections[aSlot] = mConnections[last];
+        mConnections[aSlot]->mSlot = aSlot;
+        mHandles[aSlot] = mHandles[last];
+        *mSlots.Get(mHandles[aSlot]) = aSlot;
+    }
+
+    mIds.pop_back();
+    mActive.pop_back();
+    mLastSendTimes.pop_back();
+    mLastReceiveTimes.pop_back();
+    mConnections.pop_back();
+    mHandles.pop_back();
+}
+
+bool ConnectionTable::Find(uint64_t aConnectionId, uint32_t* aSlot) {
+    uint32_t* slot = mSlots.Find(aConnectionId);
+    if (!slot) { return false; }
+    *aSlot = *slot;
+    return true;
+}
+
+bool ConnectionTable::Resolve(SlotHandle aHandle, uint32_t* aSlot) {
+    uint32_t* slot = mSlots.Get(aHandle);
+    if (!slot) { return false; }
+    *aSlot = *slot;
+    return true;
+}
+
+Connection* ConnectionTable::Resolve(const ConnectionRef& aRef) {
+    uint32_t slot = 0;
+    if (!aRef.table || !aRef.table->Resolve(aRef.handle, &slot)) { return nullptr; }
+    return aRef.table->mConnections[slot];
+}
+
+Connection* ConnectionTable::Get(uint64_t aConnectionId) {
+    uint32_t slot = 0;
+    return Find(aConnectionId, &slot) ? mConnections[slot] : nullptr;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "slotmap.hpp"
+
+class Connection;
+class ConnectionTable;
+
+// How a connection is held on to from outside its worker, like by a lobby.
+// The id stays readable after the connection is gone, the connection itself
+// is only reached through the handle, which stops resolving once it's freed.
+typedef struct {
+    uint64_t id;
+    ConnectionTable* table;
+    SlotHandle handle;
+} ConnectionRef;
+
+// A worker's connections, with the state its timers and sweeps look at
+// packed into parallel arrays indexed by slot, so going over every
+// connection streams through memory instead of chasing pointers.
+// The rest of the connection stays behind the pointer in the last array.
+// Slots are dense: removing one moves the last connection into its place,
+// so anything kept around (timers, socket events) holds a handle instead,
+// which stops resolving once its connection is gone.
+// Only the owning worker adds or removes, while holding the server's lobby mutex.
+class ConnectionTable {
+    private:
+        std::vector<uint64_t> mIds;
+        std::vector<uint8_t> mActive;
+        std::vector<uint64_t> mLastSendTimes;
+        std::vector<uint64_t> mLastReceiveTimes;
+        std::vector<Connection*> mConnections;
+        std::vector<SlotHandle> mHandles;
+        SlotMap<uint32_t> mSlots;
+
+    public:
+        void Add(Connection* aConnection);
+        void Remove(uint32_t aSlot);
+        bool Find(uint64_t aConnectionId, uint32_t* aSlot);
+        bool Resolve(SlotHandle aHandle, uint32_t* aSlot);
+        Connection* Get(uint64_t aConnectionId);
+
+        // nullptr for a connection that was freed or never had a table,
+        // the caller holds the server's lobby mutex like for Get()
+        static Connection* Resolve(const ConnectionRef& aRef);
+
+        uint32_t Size() { return (uint32_t)mIds.size(); }
+        uint64_t Id(uint32_t aSlot) { return mIds[aSlot]; }
+        bool Active(uint32_t aSlot) { return mActive[aSlot] != 0; }
+        uint64_t LastSendTime(uint32_t aSlot) { return mLastSendTimes[aSlot]; }
+        uint64_t LastReceiveTime(uint32_t aSlot) { return mLastReceiveTimes[aSlot]; }
+        Connection* At(uint32_t aSlot) { return mConnections[aSlot]; }
+
+        void SetActive(uint32_t aSlot, bool aActive) { mActive[aSlot] = aActive ? 1 : 0; }
+        void SetLastSendTime(uint32_t aSlot, uint64_t aTime) { mLastSendTimes[aSlot] = aTime; }
+        void SetLastReceiveTime(uint32_t aSlot, uint64_t aTime) { mLastReceiveTimes[aSlot] = aTime; }
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define FLATMAP_GROUP 16
+#define FLATMAP_EMPTY ((int8_t)-128)
+#define FLATMAP_DELETED ((int8_t)-2)
+
+// An open addressing hash map for 64-bit ids.
+// Every slot has a control byte: empty, deleted, or seven bits of the key's hash.
+// A lookup compares sixteen control bytes at once and only reads the keys whose
+// bits match, so a probe usually touches one control group and one entry.
+// Keys and values sit in a flat array instead of one allocation per node.
+// Pointers into the map are only valid until the next Insert().
+// Not thread safe, the owner guards it.
+template <typename T>
+class FlatMap {
+    private:
+        typedef struct {
+            uint64_t key;
+            T value;
+        } Entry;
+
+        std::vector<int8_t> mControl;
+        std::vector<Entry> mEntries;
+        size_t mCapacity = 0;
+        size_t mSize = 0;
+        size_t mDeleted = 0;
+
+        static uint64_t Hash(uint64_t aKey) {
+            // ids may be random, but info bits and addresses aren't
+            aKey ^= aKey >> 33;
+            aKey *= 0xff51afd7ed558ccdULL;
+            aKey ^= aKey >> 33;
+            aKey *= 0xc4ceb9fe1a85ec53ULL;
+            aKey ^= aKey >> 33;
+            return aKey;
+        }
+
+        // one bit per control byte in the group that equals aByte
+        static uint32_t Match(const int8_t* aGroup, int8_t aByte) {
+#if defined(__SSE2__)
+            __m128i group = _mm_loadu_si128((const __m128i*)aGroup);
+            return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(aByte)));
+#else
+            uint32_t mask = 0;
+            for (int i = 0; i < FLATMAP_GROUP; i++) {
+                if (aGroup[i] == aByte) { mask |= (1u << i); }
+            }
+            return mask;
+#endif
+        }
+
+        // one bit per empty or deleted control byte, both have the high bit set
+        static uint32_t MatchFree(const int8_t* aGroup) {
+#if defined(__SSE2__)
+            return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)aGroup));
+#else
+            uint32_t mask = 0;
+            for (int i = 0; i < FLATMAP_GROUP; i++) {
+                if (aGroup[i] < 0) { mask |= (1u << i); }
+            }
+            return mask;
+#endif
+        }
+
+        static int LowestBit(uint32_t aMask) {
+            return __builtin_ctz(aMask);
+        }
+
+        // where aKey is, or SIZE_MAX
+        size_t Locate(uint64_t aKey) const {
+            if (mCapacity == 0) { return SIZE_MAX; }
+            uint64_t hash = Hash(aKey);
+            int8_t tag = (int8_t)(hash & 0x7F);
+            size_t groups = mCapacity / FLATMAP_GROUP;
+            size_t group = (size_t)(hash >> 7) & (groups - 1);
+
+            // triangular steps visit every group when there's a power of two of them
+            for (size_t step = 1; step <= groups; step++) {
+                const int8_t* control = &mControl[group * FLATMAP_GROUP];
+                for (uint32_t mask = Match(control, tag); mask != 0; mask &= mask - 1) {
+                    size_t index = group * FLATMAP_GROUP + LowestBit(mask);
+                    if (mEntries[index].key == aKey) { return index; }
+                }
+                if (Match(control, FLATMAP_EMPTY) != 0) { return SIZE_MAX; }
+                group = (group + step) & (groups - 1);
+            }
+            return SIZE_MAX;
+        }
+
+        // the first free slot along aKey's probe sequence, there always is one
+        size_t LocateFree(uint64_t aKey) const {
+            uint64_t hash = Hash(aKey);
+            size_t groups = mCapacity / FLATMAP_GROUP;
+            size_t group = (size_t)(hash >> 7) & (groups - 1);
+            for (size_t step = 1; ; step++) {
+                uint32_t mask = MatchFree(&mControl[group * FLATMAP_GROUP]);
+                if (mask != 0) { return group * FLATMAP_GROUP + LowestBit(mask); }
+                group = (group + step) & (groups - 1);
+            }
+        }
+
+        void Rehash(size_t aCapacity) {
+            std::vector<int8_t> control(aCapacity, FLATMAP_EMPTY);
+            std::vector<Entry> entries(aCapacity);
+            control.swap(mControl);
+            entries.swap(mEntries);
+            size_t capacity = mCapacity;
+            mCapacity = aCapacity;
+            mDeleted = 0;
+
+            for (size_t i = 0; i < capacity; i++) {
+                if (control[i] < 0) { continue; }
+                size_t index = LocateFree(entries[i].key);
+                mControl[index] = control[i];
+                mEntries[index] = std::move(entries[i]);
+            }
+        }
+
+        void EraseAt(size_t aIndex) {
+            // a probe may have passed through here, so it's marked instead of emptied
+            mControl[aIndex] = FLATMAP_DELETED;
+            mEntries[aIndex].value = T();
+            mSize--;
+            mDeleted++;
+        }
+
+    public:
+        T* Find(uint64_t aKey) {
+            size_t index = Locate(aKey);
+            return (index == SIZE_MAX) ? nullptr : &mEntries[index].value;
+        }
+
+        bool Contains(uint64_t aKey) const {
+            return Locate(aKey) != SIZE_MAX;
+        }
+
+        // adds aKey, or overwrites its value if it's already there
+        T* Insert(uint64_t aKey, const T& aValue) {
+            size_t index = Locate(aKey);
+            if (index != SIZE_MAX) {
+                mEntries[index].value = aValue;
+                return &mEntries[index].value;
+            }
+
+            // keep at most 7/8ths taken, deleted slots count since they lengthen probes
+            if ((mSize + mDeleted + 1) * 8 > mCapacity * 7) {
+                size_t capacity = (mCapacity == 0) ? FLATMAP_GROUP : mCapacity;
+                while ((mSize + 1) * 8 > capacity * 7 / 2) { capacity *= 2; }
+                Rehash(capacity);
+            }
+
+            index = LocateFree(aKey);
+            if (mControl[index] == FLATMAP_DELETED) { mDeleted--; }
+            mControl[index] = (int8_t)(Hash(aKey) & 0x7F);
+            mEntries[index].key = aKey;
+            mEntries[index].value = aValue;
+            mSize++;
+            return &mEntries[index].value;
+        }
+
+        bool Erase(uint64_t aKey) {
+            size_t index = Locate(aKey);
+            if (index == SIZE_MAX) { return false; }
+            EraseAt(index);
+            return true;
+        }
+
+        // calls aCallback(key, value) for every entry and erases the ones it returns true for
+        template <typename F>
+        void EraseIf(F aCallback) {
+            for (size_t i = 0; i < mCapacity; i++) {
+                if (mControl[i] < 0) { continue; }
+                if (aCallback(mEntries[i].key, mEntries[i].value)) { EraseAt(i); }
+            }
+        }
+
+        size_t Size() const { return mSize; }
+};
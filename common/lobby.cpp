@@ -11,39 +11,49 @@ void (*gOnLobbyJoin)(Lobby* lobby, Connection* connection) = nullptr;
 void (*gOnLobbyLeave)(Lobby* lobby, Connection* connection) = nullptr;
 void (*gOnLobbyDestroy)(Lobby* lobby) = nullptr;
 
-Lobby::Lobby(Connection* aOwner, uint64_t aId, std::string& aGame, std::string& aVersion, std::string& aHostName, std::string& aMode, uint16_t aMaxConnections, std::string& aPassword, std::string& aDescription) {
-    mOwner = aOwner;
+Lobby::Lobby(Connection* aOwner, uint64_t aId, const StringView& aGame, const StringView& aVersion, const StringView& aHostName, const StringView& aMode, uint16_t aMaxConnections, const StringView& aPassword, const StringView& aDescription) {
+    mOwner = aOwner->Ref();
     mId = aId;
-    mGame = aGame;
-    mVersion = aVersion;
-    mHostName = aHostName;
-    mMode = aMode;
+    mGame = aGame.ToString();
+    mVersion = aVersion.ToString();
+    mHostName = aHostName.ToString();
+    mMode = aMode.ToString();
     mMaxConnections = aMaxConnections;
-    mPassword = aPassword;
-    mDescription = aDescription;
+    mPassword = aPassword.ToString();
+    mDescription = aDescription.ToString();
 }
 
 Lobby::~Lobby() {
     LOG_INFO("Destroying lobby %" PRIu64 "", mId);
 
     for (auto& it : mConnections) {
-        if (!it) { continue; }
-        if (it->mLobby != this) { continue; }
-        if (gOnLobbyLeave) { gOnLobbyLeave(this, it); }
-        it->mLobby = nullptr;
+        Connection* connection = ConnectionTable::Resolve(it);
+        if (!connection) { continue; }
+        if (connection->mLobby != this) { continue; }
+        if (gOnLobbyLeave) { gOnLobbyLeave(this, connection); }
+        connection->mLobby = nullptr;
     }
     mConnections.clear();
 
     if (gOnLobbyDestroy) { gOnLobbyDestroy(this); }
 }
 
-enum MPacketErrorNumber Lobby::Join(Connection* aConnection, std::string& aPassword) {
+Connection* Lobby::Owner() {
+    return ConnectionTable::Resolve(mOwner);
+}
+
+bool Lobby::IsOwner(Connection* aConnection) {
+    return aConnection && aConnection->mId == mOwner.id;
+}
+
+enum MPacketErrorNumber Lobby::Join(Connection* aConnection, const StringView& aPassword) {
     // sanity check
     if (!aConnection) { return MERR_LOBBY_JOIN_FAILED; }
     if (aConnection->mLobby == this) { return MERR_NONE; }
 
     // make sure people are updated
-    if (mOwner->mUpdated && !aConnection->mUpdated) { return MERR_LOBBY_JOIN_FAILED; }
+    Connection* owner = Owner();
+    if (owner && owner->mUpdated && !aConnection->mUpdated) { return MERR_LOBBY_JOIN_FAILED; }
 
     // leave older lobby
     if (aConnection->mLobby != nullptr) {
@@ -56,13 +66,14 @@ enum MPacketErrorNumber Lobby::Join(Connection* aConnection, std::string& aPassw
     }
 
     // make sure password matches
-    if (mPassword != aPassword) {
+    if (aPassword != mPassword) {
         return MERR_LOBBY_PASSWORD_INCORRECT;
     }
 
-    auto it = std::find(mConnections.begin(), mConnections.end(), aConnection);
+    uint64_t id = aConnection->mId;
+    auto it = std::find_if(mConnections.begin(), mConnections.end(), [id](const ConnectionRef& aRef) { return aRef.id == id; });
     if (it == mConnections.end()) {
-        mConnections.push_back(aConnection);
+        mConnections.push_back(aConnection->Ref());
     }
     aConnection->mLobby = this;
     aConnection->mPriority = mNextPriority++;
@@ -77,11 +88,12 @@ void Lobby::Leave(Connection* aConnection) {
 
     if (gOnLobbyLeave) { gOnLobbyLeave(this, aConnection); }
 
-    mConnections.erase(std::remove(mConnections.begin(), mConnections.end(), aConnection), mConnections.end());
+    uint64_t id = aConnection->mId;
+    mConnections.erase(std::remove_if(mConnections.begin(), mConnections.end(), [id](const ConnectionRef& aRef) { return aRef.id == id; }), mConnections.end());
 
     aConnection->mLobby = nullptr;
 
-    if (mOwner == aConnection) {
+    if (IsOwner(aConnection)) {
         delete this;
     }
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include "socket.hpp"
 #include "connection.hpp"
 #include "utils.hpp"
+#include "slotmap.hpp"
+#include "connectiontable.hpp"
 
 class Connection;
 
@@ -12,9 +14,12 @@ class Lobby {
     private:
     public:
         bool mActive = false;
-        Connection* mOwner = nullptr;
+        // the owner and members may belong to other workers, they're resolved
+        // on use so one that has been freed is skipped instead of touched
+        ConnectionRef mOwner = { 0, nullptr, 0 };
         uint64_t mId = 0;
-        std::vector<Connection*> mConnections;
+        SlotHandle mHandle = 0;
+        std::vector<ConnectionRef> mConnections;
         uint16_t mMaxConnections = 16;
         uint32_t mNextPriority = 0;
 
@@ -25,10 +30,17 @@ class Lobby {
         std::string mPassword;
         std::string mDescription;
 
-        Lobby(Connection* aOwner, uint64_t aId, std::string& aGame, std::string& aVersion, std::string& aHostName, std::string& aMode, uint16_t aMaxConnections, std::string& aPassword, std::string& aDescription);
+        // position in the server's lobby directory
+        uint64_t mDirectoryKey = 0;
+        size_t mDirectoryIndex = 0;
+
+        Lobby(Connection* aOwner, uint64_t aId, const StringView& aGame, const StringView& aVersion, const StringView& aHostName, const StringView& aMode, uint16_t aMaxConnections, const StringView& aPassword, const StringView& aDescription);
         ~Lobby();
 
-        enum MPacketErrorNumber Join(Connection* aConnection, std::string& aPassword);
+        Connection* Owner();
+        bool IsOwner(Connection* aConnection);
+
+        enum MPacketErrorNumber Join(Connection* aConnection, const StringView& aPassword);
         void Leave(Connection* aConnection);
 };
 
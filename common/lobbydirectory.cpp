@@ -0,0 +1,136 @@
+#include "lobbydirectory.hpp"
+#include "lobby.hpp"
+#include "mpacket.hpp"
+
+#define LOBBY_DIRECTORY_FNV_OFFSET 14695981039346656037ULL
+#define LOBBY_DIRECTORY_FNV_PRIME 1099511628211ULL
+
+static uint64_t sHash(uint64_t aHash, const StringView& aString) {
+    const uint8_t* c = (const uint8_t*)aString.Data();
+    for (size_t i = 0; i < aString.Size(); i++) {
+        aHash ^= c[i];
+        aHash *= LOBBY_DIRECTORY_FNV_PRIME;
+    }
+    return aHash;
+}
+
+uint64_t LobbyDirectory::Key(const StringView& aGame, const StringView& aPassword) {
+    // received strings never contain a terminator, so it separates the two
+    uint64_t hash = sHash(LOBBY_DIRECTORY_FNV_OFFSET, aGame);
+    hash *= LOBBY_DIRECTORY_FNV_PRIME;
+    return sHash(hash, aPassword);
+}
+
+void LobbyDirectory::Add(Lobby* aLobby) {
+    aLobby->mDirectoryKey = Key(aLobby->mGame, aLobby->mPassword);
+    LobbyDirectoryBucket& bucket = mBuckets[aLobby->mDirectoryKey];
+    aLobby->mDirectoryIndex = bucket.lobbies.size();
+    bucket.lobbies.push_back(aLobby);
+    bucket.version++;
+    mCount++;
+}
+
+void LobbyDirectory::Remove(Lobby* aLobby) {
+    auto it = mBuckets.find(aLobby->mDirectoryKey);
+    if (it == mBuckets.end()) { return; }
+
+    std::vector<Lobby*>& lobbies = it->second.lobbies;
+    size_t index = aLobby->mDirectoryIndex;
+    if (index >= lobbies.size() || lobbies[index] != aLobby) { return; }
+
+    // swap the last lobby into the hole
+    lobbies[index] = lobbies.back();
+    lobbies[index]->mDirectoryIndex = index;
+    lobbies.pop_back();
+    it->second.version++;
+    if (lobbies.empty()) { mBuckets.erase(it); }
+    mCount--;
+}
+
+void LobbyDirectory::Update(Lobby* aLobby) {
+    // only move buckets when the game or password changed
+    if (Key(aLobby->mGame, aLobby->mPassword) != aLobby->mDirectoryKey) {
+        Remove(aLobby);
+        Add(aLobby);
+        return;
+    }
+    Invalidate(aLobby);
+}
+
+void LobbyDirectory::Invalidate(Lobby* aLobby) {
+    auto it = mBuckets.find(aLobby->mDirectoryKey);
+    if (it == mBuckets.end()) { return; }
+    it->second.version++;
+}
+
+const std::vector<Lobby*>* LobbyDirectory::Find(const StringView& aGame, const StringView& aPassword) {
+    auto it = mBuckets.find(Key(aGame, aPassword));
+    if (it == mBuckets.end()) { return nullptr; }
+    return &it->second.lobbies;
+}
+
+void LobbyDirectory::Encode(LobbyDirectoryList& aList, LobbyDirectoryBucket* aBucket, const StringView& aGame, const StringView& aPassword) {
+    uint8_t data[MPACKET_MAX_SIZE];
+
+    if (aBucket) {
+        for (auto& it : aBucket->lobbies) {
+            if (aGame != it->mGame) { continue; }
+            if (aPassword != it->mPassword) { continue; }
+
+            int64_t dataSize = MPacketLobbyListGot({
+                .lobbyId = it->mId,
+                .ownerId = it->mOwner.id,
+                .connections = (uint16_t)it->mConnections.size(),
+                .maxConnections = it->mMaxConnections
+            }, {
+                it->mGame,
+                it->mVersion,
+                it->mHostName,
+                it->mMode,
+                it->mDescription,
+            }).Serialize(data, MPACKET_MAX_SIZE);
+            if (dataSize > 0) {
+                aList.bytes.append((const char*)data, (size_t)dataSize);
+                PacketStats::Count(aList.counts, MPACKET_LOBBY_LIST_GOT, (uint64_t)dataSize);
+            }
+        }
+    }
+
+    int64_t dataSize = MPacketLobbyListFinish({ 0 }).Serialize(data, MPACKET_MAX_SIZE);
+    if (dataSize > 0) {
+        aList.bytes.append((const char*)data, (size_t)dataSize);
+        PacketStats::Count(aList.counts, MPACKET_LOBBY_LIST_FINISH, (uint64_t)dataSize);
+    }
+}
+
+std::shared_ptr<LobbyDirectoryList> LobbyDirectory::List(const StringView& aGame, const StringView& aPassword) {
+    auto it = mBuckets.find(Key(aGame, aPassword));
+
+    // nothing matches, every game shares the same lone finish packet
+    if (it == mBuckets.end()) {
+        if (!mEmptyList) {
+            mEmptyList = std::make_shared<LobbyDirectoryList>();
+            Encode(*mEmptyList, nullptr, aGame, aPassword);
+        }
+        return mEmptyList;
+    }
+
+    // private lists are rare and small, don't keep them around
+    LobbyDirectoryBucket& bucket = it->second;
+    if (!aPassword.Empty()) {
+        std::shared_ptr<LobbyDirectoryList> list = std::make_shared<LobbyDirectoryList>();
+        Encode(*list, &bucket, aGame, aPassword);
+        return list;
+    }
+
+    // reuse the public list until a lobby in it changes
+    if (bucket.list && bucket.listVersion == bucket.version && aGame == bucket.listGame) {
+        return bucket.list;
+    }
+
+    bucket.list = std::make_shared<LobbyDirectoryList>();
+    bucket.listVersion = bucket.version;
+    bucket.listGame = aGame.ToString();
+    Encode(*bucket.list, &bucket, aGame, aPassword);
+    return bucket.list;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "stringview.hpp"
+#include "packetstats.hpp"
+
+class Lobby;
+
+// an encoded list response and what sending it adds to the packet stats
+typedef struct {
+    std::string bytes;
+    std::vector<PacketCount> counts;
+} LobbyDirectoryList;
+
+typedef struct {
+    std::vector<Lobby*> lobbies;
+    uint64_t version;
+
+    // encoded list responses for the public lobbies in this bucket
+    std::shared_ptr<LobbyDirectoryList> list;
+    uint64_t listVersion;
+    std::string listGame;
+} LobbyDirectoryBucket;
+
+// Lobbies bucketed by a hash of their game and password, so a list request
+// only has to look at the lobbies it could possibly match.
+// Buckets may still hold the odd collision, callers compare the strings.
+// Public buckets also keep their list response pre-encoded until a lobby in
+// them changes.
+// Guarded by the server's lobby mutex like the rest of the lobby state.
+class LobbyDirectory {
+    private:
+        std::unordered_map<uint64_t, LobbyDirectoryBucket> mBuckets;
+        std::shared_ptr<LobbyDirectoryList> mEmptyList;
+        size_t mCount = 0;
+
+        void Encode(LobbyDirectoryList& aList, LobbyDirectoryBucket* aBucket, const StringView& aGame, const StringView& aPassword);
+
+    public:
+        static uint64_t Key(const StringView& aGame, const StringView& aPassword);
+
+        void Add(Lobby* aLobby);
+        void Remove(Lobby* aLobby);
+        void Update(Lobby* aLobby);
+        void Invalidate(Lobby* aLobby);
+        const std::vector<Lobby*>* Find(const StringView& aGame, const StringView& aPassword);
+        std::shared_ptr<LobbyDirectoryList> List(const StringView& aGame, const StringView& aPassword);
+
+        size_t Count() { return mCount; }
+};
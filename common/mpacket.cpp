@@ -1,5 +1,6 @@
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <string>
 #include <errno.h>
 #include "libcoopnet.h"
@@ -9,8 +10,11 @@
 #include "server.hpp"
 #include "client.hpp"
 #include "utils.hpp"
+#include "worker.hpp"
+#include "packetstats.hpp"
 
-static MPacket* sPacketByType[MPACKET_MAX] = {
+// decoded packets are reused, so each server worker needs its own set
+static thread_local MPacket* sPacketByType[MPACKET_MAX] = {
     new MPacket(),
     new MPacketJoined(),
     new MPacketLobbyCreate(),
@@ -34,31 +38,26 @@ static MPacket* sPacketByType[MPACKET_MAX] = {
     new MPacketLoadBalance(),
 };
 
-void MPacket::Send(Connection& connection) {
-    // make sure its connected
-    if (!connection.mActive) {
-        return;
-    }
-
+int64_t MPacket::Serialize(uint8_t* aData, int64_t aMaxDataSize) {
     // figure out string size
     int64_t stringSize = 0;
     for (const auto& s : mStringData) {
-        int64_t size = strlen(s.c_str());
+        int64_t size = (int64_t)s.size();
         if (size >= UINT16_MAX) {
             LOG_ERROR("Tried to include a string that was too large: %" PRId64 "", size);
-            return;
+            return -1;
         }
         stringSize += sizeof(uint16_t) + size;
     }
     if (stringSize >= UINT16_MAX) {
         LOG_ERROR("Tried to include a total string size that was too large: %" PRId64 "", stringSize);
-        return;
+        return -1;
     }
 
     // sanity check void data size
     if (mVoidDataSize >= UINT16_MAX) {
         LOG_ERROR("Tried to include a total void data size that was too large: %" PRId64 "", mVoidDataSize);
-        return;
+        return -1;
     }
 
     // setup packet header
@@ -71,20 +70,13 @@ void MPacket::Send(Connection& connection) {
 
     // figure out data size
     int64_t dataSize = sizeof(MPacketHeader) + pHeader.dataSize + pHeader.stringSize;
-    if (dataSize > (int64_t)MPACKET_MAX_SIZE || dataSize >= (int64_t)UINT16_MAX) {
-        LOG_ERROR("Packet size exceeded max size (%" PRIu64 " > %" PRIu64 ")", (uint64_t)dataSize, (uint64_t)MPACKET_MAX_SIZE);
-        return;
-    }
-
-    // allocate data
-    uint8_t* data = (uint8_t*) malloc(dataSize);
-    if (!data) {
-        LOG_ERROR("Error allocating data");
-        return;
+    if (dataSize > aMaxDataSize || dataSize >= (int64_t)UINT16_MAX) {
+        LOG_ERROR("Packet size exceeded max size (%" PRIu64 " > %" PRIu64 ")", (uint64_t)dataSize, (uint64_t)aMaxDataSize);
+        return -1;
     }
 
     // fill header
-    uint8_t* d = &data[0];
+    uint8_t* d = &aData[0];
     memcpy(d, &pHeader, sizeof(MPacketHeader));
     d += sizeof(MPacketHeader);
 
@@ -94,64 +86,79 @@ void MPacket::Send(Connection& connection) {
 
     // fill strings
     for (const auto& s : mStringData) {
-        const char* c = s.c_str();
-
-        // fill string length
-        uint16_t slength = strlen(c);
-        *((uint16_t*)d) = slength;
+        uint16_t slength = (uint16_t)s.size();
+        memcpy(d, &slength, sizeof(uint16_t));
         d += sizeof(uint16_t);
-
-        // fill string
-        for (uint16_t i = 0; i < slength; i++) {
-            *d = *c;
-            d++;
-            c++;
-        }
+        memcpy(d, s.data(), slength);
+        d += slength;
     }
 
-    // send data buffer
-    SOCKET_RESET_ERROR();
-    int sent = sendto(connection.mSocket, (char*)&data[0], dataSize, MSG_NOSIGNAL, (const sockaddr*)&connection.mAddress, sizeof(struct sockaddr_in));
-    int rc = SOCKET_LAST_ERROR;
-    if (rc != SOCKET_EAGAIN && rc != 0) {
-        LOG_ERROR("Socket sendto error: %d", rc);
-    }
-    //LOG_INFO("SENT: %d, %d, %" PRId64 "", sent, rc, dataSize);
+    return dataSize;
+}
+
+// serialize into a buffer that is reused by every send on this thread
+static thread_local uint8_t sSendData[MPACKET_MAX_SIZE];
 
-    // debug print packet
-    /*LOG_INFO("Sent data:");
-    for (size_t i = 0; i < dataSize; i++) {
-        printf("  %02X", data[i]);
+// hands encoded bytes to a connection, connections are owned by a single
+// server worker so anyone else has to let that worker do the sending.
+// False if there was nobody to send them to, the caller counts what went out
+bool MPacket::SendEncoded(Connection& aConnection, const uint8_t* aData, int64_t aDataSize, std::shared_ptr<std::string>& aShared, bool aBulk) {
+    bool foreign = (aConnection.mWorker && aConnection.mWorker != Worker::Current());
+    if (!foreign && !aConnection.mActive) { return false; }
+
+    if (!foreign) {
+        aConnection.Send(aData, aDataSize, aBulk);
+        return true;
     }
-    printf("\n");*/
 
-    // free data buffer
-    free(data);
+    // the bytes outlive this call, every worker shares the same copy
+    if (!aShared) {
+        aShared = std::make_shared<std::string>((const char*)aData, (size_t)aDataSize);
+    }
+    aConnection.mWorker->PostBytes(aConnection.mId, aShared, aBulk);
+    return true;
+}
 
-    // check for send error
-    if (sent < 0) {
-        LOG_ERROR("Error sending data (%d)!", rc);
+void MPacket::Send(Connection& connection) {
+    // make sure its connected
+    bool foreign = (connection.mWorker && connection.mWorker != Worker::Current());
+    if (!foreign && !connection.mActive) {
+        return;
     }
 
-    // check for data size error
-    if (sent != (int)dataSize) {
-        LOG_ERROR("Error sending data, did not send all bytes (%d != %" PRIu64 ")!", sent, (uint64_t)dataSize);
+    int64_t dataSize = Serialize(sSendData, MPACKET_MAX_SIZE);
+    if (dataSize < 0) {
+        return;
     }
 
-    // update last send time
-    std::chrono::system_clock::time_point nowTp = std::chrono::system_clock::now();
-    connection.mLastSendTime = std::chrono::system_clock::to_time_t(nowTp);
+    std::shared_ptr<std::string> shared;
+    if (SendEncoded(connection, sSendData, dataSize, shared)) {
+        PacketStats::Sent(GetImplSettings().packetType, 1, (uint64_t)dataSize);
+    }
 }
 
 void MPacket::Send(Lobby& lobby) {
+    // encode once, every member gets the same bytes
+    int64_t dataSize = Serialize(sSendData, MPACKET_MAX_SIZE);
+    if (dataSize < 0) {
+        return;
+    }
+
+    std::shared_ptr<std::string> shared;
+    uint64_t sent = 0;
     for (auto& it : lobby.mConnections) {
-        Send(*it);
+        Connection* member = ConnectionTable::Resolve(it);
+        if (member && SendEncoded(*member, sSendData, dataSize, shared)) { sent++; }
+    }
+    if (sent > 0) {
+        PacketStats::Sent(GetImplSettings().packetType, sent, sent * (uint64_t)dataSize);
     }
 }
 
-void MPacket::Process(Connection* connection, uint8_t* aData) {
+MPacket* MPacket::Decode(uint8_t* aData) {
     // extract variables from data
-    MPacketHeader header = *(MPacketHeader*)aData;
+    MPacketHeader header;
+    memcpy(&header, aData, sizeof(MPacketHeader));
     void* voidData = &aData[sizeof(MPacketHeader)];
     void* stringData = &aData[sizeof(MPacketHeader) + header.dataSize];
     bool parseError = false;
@@ -165,7 +172,7 @@ void MPacket::Process(Connection* connection, uint8_t* aData) {
     // sanity check packet type
     if (header.packetType >= MPACKET_MAX || header.packetType == MPACKET_NONE) {
         LOG_ERROR("Received an unknown packet type: %u, data size: %u, string size: %u", header.packetType, header.dataSize, header.stringSize);
-        return;
+        return nullptr;
     }
 
     // receive packet
@@ -178,102 +185,125 @@ void MPacket::Process(Connection* connection, uint8_t* aData) {
             packetSize = packet->mRequiredSize;
         } else {
             LOG_ERROR("Received the wrong data size: %u != %" PRId64 " (required %" PRId64 ") (packetType %u)", header.dataSize, packet->mVoidDataSize, packet->mRequiredSize, header.packetType);
-            return;
+            return nullptr;
         }
     }
 
     // receive data
     memcpy(packet->mVoidData, voidData, packetSize);
 
-    // receive strings
-    packet->mStringData.clear();
+    // string limits come from the impl settings
+    MPacketImplSettings impl = packet->GetImplSettings();
+
+    // receive strings as views into the buffer
+    packet->mStringViews.clear();
     uint8_t* c = (uint8_t*)stringData;
     uint8_t* climit = c + header.stringSize;
     while (c < climit) {
         // retrieve string length
-        uint16_t length = *(uint16_t*)c;
-        c += sizeof(uint16_t);
-        if (c >= climit) {
-            if (length == 0) {
-                packet->mStringData.push_back("");
-                break;
-            }
+        uint16_t length = 0;
+        if (climit - c < (int64_t)sizeof(uint16_t)) {
             parseError = true;
             break;
         }
-
-        // allocate string
-        char* cstr = (char*)malloc(length + 1);
-        if (!cstr) {
-            LOG_ERROR("Failed to allocate string");
+        memcpy(&length, c, sizeof(uint16_t));
+        if (length > climit - c - (int64_t)sizeof(uint16_t)) {
             parseError = true;
             break;
         }
 
-        // fill string
-        snprintf(cstr, length + 1, "%s", c);
-        c += length;
+        // slide the string over its length so there's room for a terminator
+        char* cstr = (char*)c + 1;
+        memmove(cstr, c + sizeof(uint16_t), length);
+        c += sizeof(uint16_t) + length;
+
+        // stop at embedded terminators and cut to the packet's limit
+        size_t index = packet->mStringViews.size();
+        size_t size = strnlen(cstr, length);
+        uint16_t limit = (index < MPACKET_MAX_STRINGS) ? impl.stringLimits[index] : 0;
+        if (limit > 0 && size > limit) { size = limit; }
+        cstr[size] = '\0';
 
         // remember string
-        packet->mStringData.push_back(cstr);
-        free(cstr);
+        packet->mStringViews.push_back(StringView(cstr, size));
     }
-    if (c != climit) { parseError = true; }
 
     // check impl settings
-    MPacketImplSettings impl = packet->GetImplSettings();
     if (header.packetType != impl.packetType) {
         LOG_ERROR("Received packet type mismatch: %u != %u", header.packetType, impl.packetType);
-        return;
+        return nullptr;
     }
-    if (packet->mStringData.size() != impl.stringCount) {
-        LOG_ERROR("Received packet string count mismatch: %" PRIu64 " != %u", (uint64_t)packet->mStringData.size(), impl.stringCount);
-        return;
+    if (packet->mStringViews.size() != impl.stringCount) {
+        LOG_ERROR("Received packet string count mismatch: %" PRIu64 " != %u", (uint64_t)packet->mStringViews.size(), impl.stringCount);
+        return nullptr;
     }
-    if (gServer && impl.sendType == MSEND_TYPE_SERVER) {
-        LOG_ERROR("Received server packet while being a server!");
-        return;
+    if (parseError) {
+        LOG_ERROR("Packet parse error!");
+        return nullptr;
     }
-    if (gClient && impl.sendType == MSEND_TYPE_CLIENT) {
-        LOG_ERROR("Received client packet while being a client!");
+
+    return packet;
+}
+
+void MPacket::Process(Connection* connection, uint8_t* aData) {
+    uint64_t start = PacketStats::NowNs();
+    MPacketHeader header;
+    memcpy(&header, aData, sizeof(MPacketHeader));
+    uint64_t size = sizeof(MPacketHeader) + header.dataSize + header.stringSize;
+
+    MPacket* packet = Decode(aData);
+    if (!packet) {
+        PacketStats::ParseError(header.packetType, size);
         return;
     }
 
-    // receive the packet
-    if (parseError) {
-        LOG_ERROR("Packet parse error!");
+    bool ret = false;
+    MPacketImplSettings impl = packet->GetImplSettings();
+    if (gServer && impl.sendType == MSEND_TYPE_SERVER) {
+        LOG_ERROR("Received server packet while being a server!");
+    } else if (gClient && impl.sendType == MSEND_TYPE_CLIENT) {
+        LOG_ERROR("Received client packet while being a client!");
     } else {
-        bool ret = packet->Receive(connection);
-        if (!ret) { LOG_ERROR("Packet receive error %u!", header.packetType); }
+        // lobby state is shared between the server workers,
+        // packets that both sides send only relay between two connections
+        std::unique_lock<std::recursive_mutex> lobbyGuard;
+        if (gServer && impl.sendType != MSEND_TYPE_BOTH) {
+            lobbyGuard = std::unique_lock<std::recursive_mutex>(gServer->mLobbiesMutex);
+        }
+
+        // receive the packet
+        ret = packet->Receive(connection);
+        if (!ret) { LOG_ERROR("Packet receive error %u!", impl.packetType); }
     }
+
+    PacketStats::Received(header.packetType, size, PacketStats::NowNs() - start, !ret);
 }
 
-void MPacket::Read(Connection* connection, uint8_t* aData, int64_t* aDataSize, int64_t aMaxDataSize) {
-    while (true) {
-        MPacketHeader header = *(MPacketHeader*)aData;
+void MPacket::Read(Connection* connection, uint8_t* aData, int64_t* aDataSize, int64_t aMaxDataSize, MPacketProcessFunction aProcess) {
+    // walk a cursor over every complete packet in the buffer
+    int64_t offset = 0;
+    while (*aDataSize - offset >= (int64_t)sizeof(MPacketHeader)) {
+        MPacketHeader header;
+        memcpy(&header, &aData[offset], sizeof(MPacketHeader));
         int64_t totalSize = sizeof(MPacketHeader) + header.dataSize + header.stringSize;
 
         // check the received size
-        if (*aDataSize < totalSize) {
-            return;
+        if (*aDataSize - offset < totalSize) {
+            break;
         }
 
         // process
-        MPacket::Process(connection, aData);
-
-        // shift the data array
-        int64_t j = 0;
-        for (int64_t i = totalSize; i < *aDataSize; i++) {
-            aData[j++] = aData[i];
-        }
+        aProcess(connection, &aData[offset]);
+        offset += totalSize;
+    }
 
-        // reduce the current buffer size
-        *aDataSize -= totalSize;
-        if (*aDataSize < 0) {
-            LOG_ERROR("Data size below zero!");
-            *aDataSize = 0;
-        }
+    // move the partial packet that's left to the front, once per read
+    if (offset <= 0) { return; }
+    int64_t remaining = *aDataSize - offset;
+    if (remaining > 0) {
+        memmove(aData, &aData[offset], (size_t)remaining);
     }
+    *aDataSize = remaining;
 }
 
 bool MPacketJoined::Receive(Connection* connection) {
@@ -296,45 +326,45 @@ bool MPacketJoined::Receive(Connection* connection) {
 }
 
 bool MPacketLobbyCreate::Receive(Connection* connection) {
-    std::string game        = mStringData[0].substr(0, 32);
-    std::string version     = mStringData[1].substr(0, 32);
-    std::string hostName    = mStringData[2].substr(0, 32);
-    std::string mode        = mStringData[3].substr(0, 32);
-    std::string password    = mStringData[4].substr(0, 64);
-    std::string description = mStringData[5].substr(0, 256);
+    StringView& game        = mStringViews[0];
+    StringView& version     = mStringViews[1];
+    StringView& hostName    = mStringViews[2];
+    StringView& mode        = mStringViews[3];
+    StringView& password    = mStringViews[4];
+    StringView& description = mStringViews[5];
 
     LOG_INFO("[%" PRIu64 "] MPACKET_LOBBY_CREATE received: game '%s', version '%s', hostName '%s', mode '%s', maxconnections %u, password '%s'",
-        connection->mId, game.c_str(), version.c_str(), hostName.c_str(), mode.c_str(), mData.maxConnections, password.c_str());
+        connection->mId, game.Data(), version.Data(), hostName.Data(), mode.Data(), mData.maxConnections, password.Data());
     gServer->LobbyCreate(connection, game, version, hostName, mode, mData.maxConnections, password, description);
 
     return true;
 }
 
 bool MPacketLobbyCreated::Receive(Connection* connection) {
-    std::string game     = mStringData[0].substr(0, 32);
-    std::string version  = mStringData[1].substr(0, 32);
-    std::string hostName = mStringData[2].substr(0, 32);
-    std::string mode     = mStringData[3].substr(0, 32);
+    StringView& game     = mStringViews[0];
+    StringView& version  = mStringViews[1];
+    StringView& hostName = mStringViews[2];
+    StringView& mode     = mStringViews[3];
 
     LOG_INFO("[%" PRIu64 "] MPACKET_LOBBY_CREATED received: lobbyId %" PRIu64 ", game '%s', version '%s', hostName '%s', mode '%s', maxConnections %" PRIu64 "",
-        connection->mId, mData.lobbyId, game.c_str(), version.c_str(), hostName.c_str(), mode.c_str(), mData.maxConnections);
+        connection->mId, mData.lobbyId, game.Data(), version.Data(), hostName.Data(), mode.Data(), mData.maxConnections);
 
     if (gCoopNetCallbacks.OnLobbyCreated) {
-        gCoopNetCallbacks.OnLobbyCreated(mData.lobbyId, game.c_str(), version.c_str(), hostName.c_str(), mode.c_str(), mData.maxConnections);
+        gCoopNetCallbacks.OnLobbyCreated(mData.lobbyId, game.Data(), version.Data(), hostName.Data(), mode.Data(), mData.maxConnections);
     }
 
     return true;
 }
 
 bool MPacketLobbyUpdate::Receive(Connection* connection) {
-    std::string game        = mStringData[0].substr(0, 32);
-    std::string version     = mStringData[1].substr(0, 32);
-    std::string hostName    = mStringData[2].substr(0, 32);
-    std::string mode        = mStringData[3].substr(0, 32);
-    std::string description = mStringData[4].substr(0, 256);
+    StringView& game        = mStringViews[0];
+    StringView& version     = mStringViews[1];
+    StringView& hostName    = mStringViews[2];
+    StringView& mode        = mStringViews[3];
+    StringView& description = mStringViews[4];
 
     LOG_INFO("[%" PRIu64 "] MPACKET_LOBBY_UPDATE received: lobbyId %" PRIu64 ", game '%s', version '%s', hostName '%s', mode '%s'",
-        connection->mId, mData.lobbyId, game.c_str(), version.c_str(), hostName.c_str(), mode.c_str());
+        connection->mId, mData.lobbyId, game.Data(), version.Data(), hostName.Data(), mode.Data());
     gServer->LobbyUpdate(connection, mData.lobbyId, game, version, hostName, mode, description);
 
     return true;
@@ -343,7 +373,7 @@ bool MPacketLobbyUpdate::Receive(Connection* connection) {
 bool MPacketLobbyJoin::Receive(Connection* connection) {
     LOG_INFO("[%" PRIu64 "] MPACKET_LOBBY_JOIN received: lobbyId %" PRIu64 "", connection->mId, mData.lobbyId);
 
-    std::string password = mStringData[0].substr(0, 64);
+    StringView& password = mStringViews[0];
 
     Lobby* lobby = gServer->LobbyGet(mData.lobbyId);
     if (!lobby) {
@@ -416,24 +446,24 @@ bool MPacketLobbyLeft::Receive(Connection* connection) {
 }
 
 bool MPacketLobbyListGet::Receive(Connection* connection) {
-    std::string game     = mStringData[0].substr(0, 32);
-    std::string password = mStringData[1].substr(0, 64);
-    LOG_INFO("[%" PRIu64 "] MPACKET_LOBBY_LIST_GET received: game '%s'", connection->mId, game.c_str());
+    StringView& game     = mStringViews[0];
+    StringView& password = mStringViews[1];
+    LOG_INFO("[%" PRIu64 "] MPACKET_LOBBY_LIST_GET received: game '%s'", connection->mId, game.Data());
     gServer->LobbyListGet(*connection, game, password);
     return true;
 }
 
 bool MPacketLobbyListGot::Receive(Connection* connection) {
-    std::string game        = mStringData[0].substr(0, 32);
-    std::string version     = mStringData[1].substr(0, 32);
-    std::string hostName    = mStringData[2].substr(0, 32);
-    std::string mode        = mStringData[3].substr(0, 32);
-    std::string description = mStringData[4].substr(0, 256);
+    StringView& game        = mStringViews[0];
+    StringView& version     = mStringViews[1];
+    StringView& hostName    = mStringViews[2];
+    StringView& mode        = mStringViews[3];
+    StringView& description = mStringViews[4];
     LOG_INFO("[%" PRIu64 "] MPACKET_LOBBY_LIST_GOT received: lobbyId %" PRIu64 ", ownerId %" PRIu64 ", connections %u/%u, game '%s', version '%s', hostname '%s', mode '%s'",
-        connection->mId, mData.lobbyId, mData.ownerId, mData.connections, mData.maxConnections, game.c_str(), version.c_str(), hostName.c_str(), mode.c_str());
+        connection->mId, mData.lobbyId, mData.ownerId, mData.connections, mData.maxConnections, game.Data(), version.Data(), hostName.Data(), mode.Data());
 
     if (gCoopNetCallbacks.OnLobbyListGot) {
-        gCoopNetCallbacks.OnLobbyListGot(mData.lobbyId, mData.ownerId, mData.connections, mData.maxConnections, game.c_str(), version.c_str(), hostName.c_str(), mode.c_str(), description.c_str());
+        gCoopNetCallbacks.OnLobbyListGot(mData.lobbyId, mData.ownerId, mData.connections, mData.maxConnections, game.Data(), version.Data(), hostName.Data(), mode.Data(), description.Data());
     }
 
     return true;
@@ -450,23 +480,26 @@ bool MPacketLobbyListFinish::Receive(Connection* connection) {
 }
 
 bool MPacketPeerSdp::Receive(Connection *connection) {
-    std::string& sdp = mStringData[0];
-    LOG_INFO("[%" PRIu64 "] MPACKET_PEER_SDP received: lobbyId %" PRIu64 ", userId %" PRIu64 ", sdp '%s'", connection->mId, mData.lobbyId, mData.userId, sdp.c_str());
+    StringView& sdp = mStringViews[0];
+    LOG_INFO("[%" PRIu64 "] MPACKET_PEER_SDP received: lobbyId %" PRIu64 ", userId %" PRIu64 ", sdp '%s'", connection->mId, mData.lobbyId, mData.userId, sdp.Data());
     if (gServer) {
-        Connection* other = gServer->ConnectionGet(mData.userId);
+        // the other connection may belong to another worker, relay through its queue
+        MPacketPeerSdpData data = {
+           .lobbyId = mData.lobbyId,
+           .userId = connection->mId
+        };
+        std::string relaySdp = sdp.ToString();
+        bool posted = gServer->ConnectionPost(mData.userId, [data, relaySdp](Connection& aOther) {
+            MPacketPeerSdp(data, { relaySdp }).Send(aOther);
+            aOther.PeerBegin(data.userId);
+        });
 
-        if (!other) {
+        if (!posted) {
             LOG_ERROR("Could not find user: %" PRIu64 "", mData.userId);
             return false;
         }
 
-        MPacketPeerSdp({
-           .lobbyId = mData.lobbyId,
-           .userId = connection->mId
-        }, mStringData).Send(*other);
-
-        connection->PeerBegin(other->mId);
-        other->PeerBegin(connection->mId);
+        connection->PeerBegin(mData.userId);
 
         return true;
     }
@@ -479,7 +512,7 @@ bool MPacketPeerSdp::Receive(Connection *connection) {
             return false;
         }
 
-        peer->Connect(sdp.c_str());
+        peer->Connect(sdp.Data());
         return true;
     }
 
@@ -488,21 +521,24 @@ bool MPacketPeerSdp::Receive(Connection *connection) {
 }
 
 bool MPacketPeerCandidate::Receive(Connection *connection) {
-    std::string& sdp = mStringData[0];
-    LOG_INFO("[%" PRIu64 "] MPACKET_PEER_CANDIDATE received: lobbyId %" PRIu64 ", userId %" PRIu64 ", sdp '%s'", connection->mId, mData.lobbyId, mData.userId, sdp.c_str());
+    StringView& sdp = mStringViews[0];
+    LOG_INFO("[%" PRIu64 "] MPACKET_PEER_CANDIDATE received: lobbyId %" PRIu64 ", userId %" PRIu64 ", sdp '%s'", connection->mId, mData.lobbyId, mData.userId, sdp.Data());
     if (gServer) {
-        Connection* other = gServer->ConnectionGet(mData.userId);
+        // the other connection may belong to another worker, relay through its queue
+        MPacketPeerCandidateData data = {
+           .lobbyId = mData.lobbyId,
+           .userId = connection->mId
+        };
+        std::string relaySdp = sdp.ToString();
+        bool posted = gServer->ConnectionPost(mData.userId, [data, relaySdp](Connection& aOther) {
+            MPacketPeerCandidate(data, { relaySdp }).Send(aOther);
+        });
 
-        if (!other) {
+        if (!posted) {
             LOG_ERROR("Could not find user: %" PRIu64 "", mData.userId);
             return false;
         }
 
-        MPacketPeerCandidate({
-           .lobbyId = mData.lobbyId,
-           .userId = connection->mId
-        }, mStringData).Send(*other);
-
         return true;
     }
 
@@ -514,7 +550,7 @@ bool MPacketPeerCandidate::Receive(Connection *connection) {
             return false;
         }
 
-        peer->CandidateAdd(sdp.c_str());
+        peer->CandidateAdd(sdp.Data());
         return true;
     }
 
@@ -525,18 +561,20 @@ bool MPacketPeerCandidate::Receive(Connection *connection) {
 bool MPacketPeerCandidateDone::Receive(Connection *connection) {
     LOG_INFO("[%" PRIu64 "] MPACKET_PEER_CANDIDATE_DONE received: lobbyId %" PRIu64 ", userId %" PRIu64 "", connection->mId, mData.lobbyId, mData.userId);
     if (gServer) {
-        Connection* other = gServer->ConnectionGet(mData.userId);
+        // the other connection may belong to another worker, relay through its queue
+        MPacketPeerCandidateDoneData data = {
+           .lobbyId = mData.lobbyId,
+           .userId = connection->mId
+        };
+        bool posted = gServer->ConnectionPost(mData.userId, [data](Connection& aOther) {
+            MPacketPeerCandidateDone(data).Send(aOther);
+        });
 
-        if (!other) {
+        if (!posted) {
             LOG_ERROR("Could not find user: %" PRIu64 "", mData.userId);
             return false;
         }
 
-        MPacketPeerCandidateDone({
-           .lobbyId = mData.lobbyId,
-           .userId = connection->mId
-        }).Send(*other);
-
         return true;
     }
 
@@ -589,10 +627,10 @@ bool MPacketPeerFailed::Receive(Connection *connection) {
     Connection* failedPeer = (connectionRep < peerRep) ? connection : peer;
     Connection* otherPeer =  (connectionRep < peerRep) ? peer : connection;
 
-    if (lobby->mOwner == connection) {
+    if (lobby->IsOwner(connection)) {
         failedPeer = peer;
         otherPeer = connection;
-    } else if (lobby->mOwner == peer) {
+    } else if (lobby->IsOwner(peer)) {
         failedPeer = connection;
         otherPeer = peer;
     }
@@ -607,19 +645,19 @@ bool MPacketPeerFailed::Receive(Connection *connection) {
 }
 
 bool MPacketStunTurn::Receive(Connection* connection) {
-    std::string host     = mStringData[0];
-    std::string username = mStringData[1];
-    std::string password = mStringData[2];
-    LOG_INFO("[%" PRIu64 "] MPACKET_STUN_TURN received: isStun %u, host '%s', port %u, username '%s', password '%s'", connection->mId, mData.isStun, host.c_str(), mData.port, username.c_str(), password.c_str());
+    StringView& host     = mStringViews[0];
+    StringView& username = mStringViews[1];
+    StringView& password = mStringViews[2];
+    LOG_INFO("[%" PRIu64 "] MPACKET_STUN_TURN received: isStun %u, host '%s', port %u, username '%s', password '%s'", connection->mId, mData.isStun, host.Data(), mData.port, username.Data(), password.Data());
 
     if (mData.isStun) {
-        gClient->mStunServer.host = host;
+        gClient->mStunServer.host = host.ToString();
         gClient->mStunServer.port = mData.port;
     } else {
         gClient->mTurnServers.push_back({
-            .host = host,
-            .username = username,
-            .password = password,
+            .host = host.ToString(),
+            .username = username.ToString(),
+            .password = password.ToString(),
             .port = mData.port,
         });
     }
@@ -641,19 +679,22 @@ bool MPacketKeepAlive::Receive(Connection *connection) {
 }
 
 bool MPacketInfo::Receive(Connection *connection) {
-    std::string name = mStringData[0];
-    LOG_INFO("[%" PRIu64 "] MPACKET_INFO received: name '%s', destId %" PRIu64 ", infoBits %" PRIu64 "", connection->mId, name.c_str(), mData.destId, mData.infoBits);
+    StringView& name = mStringViews[0];
+    LOG_INFO("[%" PRIu64 "] MPACKET_INFO received: name '%s', destId %" PRIu64 ", infoBits %" PRIu64 "", connection->mId, name.Data(), mData.destId, mData.infoBits);
+    if (gServer) {
+        gServer->ConnectionInfoBits(connection, mData.infoBits);
+    }
     if (gCoopNetCallbacks.OnReceiveInfoBits) {
-        gCoopNetCallbacks.OnReceiveInfoBits(connection, mData.destId, mData.infoBits, mData.hash, name.c_str());
+        gCoopNetCallbacks.OnReceiveInfoBits(connection, mData.destId, mData.infoBits, mData.hash, name.Data());
     }
     return true;
 }
 
 bool MPacketLoadBalance::Receive(Connection *connection) {
-    std::string host = mStringData[0];
-    LOG_INFO("[%" PRIu64 "] MPACKET_LOAD_BALANCE received: host %s, port %u", connection->mId, host.c_str(), mData.port);
+    StringView& host = mStringViews[0];
+    LOG_INFO("[%" PRIu64 "] MPACKET_LOAD_BALANCE received: host %s, port %u", connection->mId, host.Data(), mData.port);
     if (gCoopNetCallbacks.OnLoadBalance) {
-        gCoopNetCallbacks.OnLoadBalance(host.c_str(), mData.port);
+        gCoopNetCallbacks.OnLoadBalance(host.Data(), mData.port);
     }
     return false;
 }
@@ -3,9 +3,12 @@
 #include <cstdint>
 #include <string>
 #include <vector>
+#include <memory>
+#include "stringview.hpp"
 
 #define MPACKET_PROTOCOL_VERSION 4
 #define MPACKET_MAX_SIZE ((size_t)5100)
+#define MPACKET_MAX_STRINGS 6
 
 // forward declarations
 class Connection;
@@ -153,8 +156,12 @@ typedef struct {
     enum MPacketType packetType;
     uint16_t stringCount;
     enum MPacketSendType sendType;
+    uint16_t stringLimits[MPACKET_MAX_STRINGS]; // received strings are cut to this length, zero is unlimited
 } MPacketImplSettings;
 
+// handles one complete packet out of a receive buffer
+typedef void (*MPacketProcessFunction)(Connection* connection, uint8_t* aData);
+
 class MPacket {
     private:
     protected:
@@ -162,11 +169,16 @@ class MPacket {
         int64_t mVoidDataSize = 0;
         int64_t mRequiredSize = 0;
         std::vector<std::string> mStringData;
+        std::vector<StringView> mStringViews;
 
     public:
+        int64_t Serialize(uint8_t* aData, int64_t aMaxDataSize);
         void Send(Connection& connection);
         void Send(Lobby& lobby);
-        static void Read(Connection* connection, uint8_t* aData, int64_t* aDataSize, int64_t aMaxDataSize);
+        static bool SendEncoded(Connection& connection, const uint8_t* aData, int64_t aDataSize, std::shared_ptr<std::string>& aShared, bool aBulk = false);
+        static void Read(Connection* connection, uint8_t* aData, int64_t* aDataSize, int64_t aMaxDataSize, MPacketProcessFunction aProcess = MPacket::Process);
+        // parses a packet in place without receiving it, the result is reused by the next decode on this thread
+        static MPacket* Decode(uint8_t* aData);
         static void Process(Connection* connection, uint8_t* aData);
         virtual bool Receive(Connection* connection) { return false; };
         virtual MPacketImplSettings GetImplSettings() { return {
@@ -219,7 +231,8 @@ class MPacketLobbyCreate : public MPacketImpl<MPacketLobbyCreateData> {
         MPacketImplSettings GetImplSettings() override { return {
             .packetType = MPACKET_LOBBY_CREATE,
             .stringCount = 6,
-            .sendType = MSEND_TYPE_CLIENT
+            .sendType = MSEND_TYPE_CLIENT,
+            .stringLimits = { 32, 32, 32, 32, 64, 256 }
         };}
         bool Receive(Connection* connection) override;
 };
@@ -230,7 +243,8 @@ class MPacketLobbyCreated : public MPacketImpl<MPacketLobbyCreatedData> {
         MPacketImplSettings GetImplSettings() override { return {
             .packetType = MPACKET_LOBBY_CREATED,
             .stringCount = 4,
-            .sendType = MSEND_TYPE_SERVER
+            .sendType = MSEND_TYPE_SERVER,
+            .stringLimits = { 32, 32, 32, 32 }
         };}
         bool Receive(Connection* connection) override;
 };
@@ -241,7 +255,8 @@ class MPacketLobbyUpdate : public MPacketImpl<MPacketLobbyUpdateData> {
         MPacketImplSettings GetImplSettings() override { return {
             .packetType = MPACKET_LOBBY_UPDATE,
             .stringCount = 5,
-            .sendType = MSEND_TYPE_CLIENT
+            .sendType = MSEND_TYPE_CLIENT,
+            .stringLimits = { 32, 32, 32, 32, 256 }
         };}
         bool Receive(Connection* connection) override;
 };
@@ -252,7 +267,8 @@ class MPacketLobbyJoin : public MPacketImpl<MPacketLobbyJoinData> {
         MPacketImplSettings GetImplSettings() override { return {
             .packetType = MPACKET_LOBBY_JOIN,
             .stringCount = 1,
-            .sendType = MSEND_TYPE_CLIENT
+            .sendType = MSEND_TYPE_CLIENT,
+            .stringLimits = { 64 }
         };}
         bool Receive(Connection* connection) override;
 };
@@ -296,7 +312,8 @@ class MPacketLobbyListGet : public MPacketImpl<MPacketLobbyListGetData> {
         MPacketImplSettings GetImplSettings() override { return {
             .packetType = MPACKET_LOBBY_LIST_GET,
             .stringCount = 2,
-            .sendType = MSEND_TYPE_CLIENT
+            .sendType = MSEND_TYPE_CLIENT,
+            .stringLimits = { 32, 64 }
         };}
         bool Receive(Connection* connection) override;
 };
@@ -307,7 +324,8 @@ class MPacketLobbyListGot : public MPacketImpl<MPacketLobbyListGotData> {
         MPacketImplSettings GetImplSettings() override { return {
             .packetType = MPACKET_LOBBY_LIST_GOT,
             .stringCount = 5,
-            .sendType = MSEND_TYPE_SERVER
+            .sendType = MSEND_TYPE_SERVER,
+            .stringLimits = { 32, 32, 32, 32, 256 }
         };}
         bool Receive(Connection* connection) override;
 };
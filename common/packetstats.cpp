@@ -0,0 +1,215 @@
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <cinttypes>
+#include <cstdio>
+#include <ctime>
+#include "packetstats.hpp"
+
+enum PacketStatsCounter {
+    PACKET_STATS_PACKETS_IN,
+    PACKET_STATS_BYTES_IN,
+    PACKET_STATS_PACKETS_OUT,
+    PACKET_STATS_BYTES_OUT,
+    PACKET_STATS_PARSE_ERRORS,
+    PACKET_STATS_RECEIVE_ERRORS,
+    PACKET_STATS_LATENCY_SUM,
+    PACKET_STATS_COUNTERS,
+};
+
+// only the owning thread writes to a slab, snapshots read it from any thread
+typedef struct {
+    uint64_t counters[MPACKET_MAX][PACKET_STATS_COUNTERS];
+    uint64_t latency[MPACKET_MAX][PACKET_STATS_BUCKETS];
+} PacketStatsSlab;
+
+// slabs outlive their threads so nothing that was counted goes missing
+static std::mutex sSlabsMutex;
+static std::vector<PacketStatsSlab*> sSlabs;
+static thread_local PacketStatsSlab* sSlab = nullptr;
+
+static const char* sPacketNames[MPACKET_MAX] = {
+    "unknown",
+    "joined",
+    "lobby_create",
+    "lobby_created",
+    "lobby_update",
+    "lobby_join",
+    "lobby_joined",
+    "lobby_leave",
+    "lobby_left",
+    "lobby_list_get",
+    "lobby_list_got",
+    "lobby_list_finish",
+    "peer_sdp",
+    "peer_candidate",
+    "peer_candidate_done",
+    "peer_failed",
+    "stun_turn",
+    "error",
+    "keep_alive",
+    "info",
+    "load_balance",
+};
+
+static PacketStatsSlab* sSlabGet() {
+    if (sSlab) { return sSlab; }
+
+    sSlab = new PacketStatsSlab();
+    memset(sSlab, 0, sizeof(PacketStatsSlab));
+
+    std::lock_guard<std::mutex> guard(sSlabsMutex);
+    sSlabs.push_back(sSlab);
+    return sSlab;
+}
+
+// there is a single writer, so a relaxed load and store is enough,
+// the builtins stay inline even in unoptimized builds where std::atomic does not
+static inline void sAdd(uint64_t& aCounter, uint64_t aAmount) {
+    __atomic_store_n(&aCounter, __atomic_load_n(&aCounter, __ATOMIC_RELAXED) + aAmount, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t sLoad(const uint64_t& aCounter) {
+    return __atomic_load_n(&aCounter, __ATOMIC_RELAXED);
+}
+
+static inline uint16_t sType(uint16_t aType) {
+    return (aType < MPACKET_MAX) ? aType : MPACKET_NONE;
+}
+
+uint64_t PacketStats::NowNs() {
+#ifdef _WIN32
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    // twice per packet, so skip the layers of chrono templates in unoptimized builds
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+#endif
+}
+
+size_t PacketStats::Bucket(uint64_t aNs) {
+    if (aNs < PACKET_STATS_SUB_BUCKETS) { return (size_t)aNs; }
+    if (aNs >> PACKET_STATS_MAX_BITS) { return PACKET_STATS_BUCKETS - 1; }
+
+    // the highest bit picks the power of two, the next few bits pick the bucket within it
+    int exponent = 63 - __builtin_clzll(aNs);
+    size_t sub = (size_t)(aNs >> (exponent - PACKET_STATS_SUB_BITS)) & (PACKET_STATS_SUB_BUCKETS - 1);
+    return (size_t)(exponent - PACKET_STATS_SUB_BITS + 1) * PACKET_STATS_SUB_BUCKETS + sub;
+}
+
+uint64_t PacketStats::BucketValue(size_t aBucket) {
+    if (aBucket < PACKET_STATS_SUB_BUCKETS) { return (uint64_t)aBucket; }
+
+    // the middle of the bucket
+    int exponent = (int)(aBucket / PACKET_STATS_SUB_BUCKETS) + PACKET_STATS_SUB_BITS - 1;
+    uint64_t sub = aBucket % PACKET_STATS_SUB_BUCKETS;
+    uint64_t width = 1ULL << (exponent - PACKET_STATS_SUB_BITS);
+    return (PACKET_STATS_SUB_BUCKETS + sub) * width + width / 2;
+}
+
+void PacketStats::Received(uint16_t aType, uint64_t aBytes, uint64_t aNs, bool aError) {
+    PacketStatsSlab* slab = sSlabGet();
+    uint64_t* counters = slab->counters[sType(aType)];
+    sAdd(counters[PACKET_STATS_PACKETS_IN], 1);
+    sAdd(counters[PACKET_STATS_BYTES_IN], aBytes);
+    sAdd(counters[PACKET_STATS_LATENCY_SUM], aNs);
+    if (aError) { sAdd(counters[PACKET_STATS_RECEIVE_ERRORS], 1); }
+    sAdd(slab->latency[sType(aType)][Bucket(aNs)], 1);
+}
+
+void PacketStats::ParseError(uint16_t aType, uint64_t aBytes) {
+    uint64_t* counters = sSlabGet()->counters[sType(aType)];
+    sAdd(counters[PACKET_STATS_BYTES_IN], aBytes);
+    sAdd(counters[PACKET_STATS_PARSE_ERRORS], 1);
+}
+
+void PacketStats::Sent(uint16_t aType, uint64_t aPackets, uint64_t aBytes) {
+    uint64_t* counters = sSlabGet()->counters[sType(aType)];
+    sAdd(counters[PACKET_STATS_PACKETS_OUT], aPackets);
+    sAdd(counters[PACKET_STATS_BYTES_OUT], aBytes);
+}
+
+void PacketStats::Sent(const std::vector<PacketCount>& aCounts) {
+    for (auto& it : aCounts) {
+        Sent(it.type, it.packets, it.bytes);
+    }
+}
+
+void PacketStats::Count(std::vector<PacketCount>& aCounts, uint16_t aType, uint64_t aBytes) {
+    // runs are usually one type after another, like a lobby list and its finish packet
+    for (auto& it : aCounts) {
+        if (it.type != aType) { continue; }
+        it.packets++;
+        it.bytes += aBytes;
+        return;
+    }
+    aCounts.push_back({ aType, 1, aBytes });
+}
+
+void PacketStats::Snapshot(std::vector<PacketTypeStats>& aStats) {
+    aStats.assign(MPACKET_MAX, PacketTypeStats());
+
+    std::lock_guard<std::mutex> guard(sSlabsMutex);
+    for (auto slab : sSlabs) {
+        for (int i = 0; i < MPACKET_MAX; i++) {
+            uint64_t* counters = slab->counters[i];
+            PacketTypeStats& stats = aStats[i];
+            stats.packetsIn     += sLoad(counters[PACKET_STATS_PACKETS_IN]);
+            stats.bytesIn       += sLoad(counters[PACKET_STATS_BYTES_IN]);
+            stats.packetsOut    += sLoad(counters[PACKET_STATS_PACKETS_OUT]);
+            stats.bytesOut      += sLoad(counters[PACKET_STATS_BYTES_OUT]);
+            stats.parseErrors   += sLoad(counters[PACKET_STATS_PARSE_ERRORS]);
+            stats.receiveErrors += sLoad(counters[PACKET_STATS_RECEIVE_ERRORS]);
+            stats.latencySumNs  += sLoad(counters[PACKET_STATS_LATENCY_SUM]);
+            for (size_t j = 0; j < PACKET_STATS_BUCKETS; j++) {
+                stats.latency[j] += sLoad(slab->latency[i][j]);
+            }
+        }
+    }
+}
+
+uint64_t PacketStats::Percentile(const PacketTypeStats& aStats, double aPercentile) {
+    // the histogram may be a few packets ahead of the counter, count it directly
+    uint64_t total = 0;
+    for (size_t i = 0; i < PACKET_STATS_BUCKETS; i++) { total += aStats.latency[i]; }
+    if (total == 0) { return 0; }
+
+    uint64_t rank = (uint64_t)(aPercentile / 100.0 * total + 0.5);
+    if (rank < 1) { rank = 1; }
+    if (rank > total) { rank = total; }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < PACKET_STATS_BUCKETS; i++) {
+        seen += aStats.latency[i];
+        if (seen >= rank) { return BucketValue(i); }
+    }
+    return BucketValue(PACKET_STATS_BUCKETS - 1);
+}
+
+const char* PacketStats::Name(uint16_t aType) {
+    return sPacketNames[sType(aType)];
+}
+
+std::string PacketStats::Format() {
+    std::vector<PacketTypeStats> stats;
+    Snapshot(stats);
+
+    char line[256];
+    std::string out;
+    snprintf(line, sizeof(line), "%-20s %10s %12s %10s %12s %8s %8s %10s %10s %10s %10s\n",
+        "packet", "in", "bytes in", "out", "bytes out", "parse", "receive", "mean us", "p50 us", "p99 us", "p999 us");
+    out += line;
+
+    for (uint16_t i = 0; i < MPACKET_MAX; i++) {
+        PacketTypeStats& it = stats[i];
+        if (it.packetsIn == 0 && it.packetsOut == 0 && it.parseErrors == 0) { continue; }
+
+        double mean = (it.packetsIn > 0) ? it.latencySumNs / 1000.0 / it.packetsIn : 0;
+        snprintf(line, sizeof(line), "%-20s %10" PRIu64 " %12" PRIu64 " %10" PRIu64 " %12" PRIu64 " %8" PRIu64 " %8" PRIu64 " %10.2f %10.2f %10.2f %10.2f\n",
+            Name(i), it.packetsIn, it.bytesIn, it.packetsOut, it.bytesOut, it.parseErrors, it.receiveErrors, mean,
+            Percentile(it, 50) / 1000.0, Percentile(it, 99) / 1000.0, Percentile(it, 99.9) / 1000.0);
+        out += line;
+    }
+    return out;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "mpacket.hpp"
+
+// latencies are kept in log-linear buckets like an HDR histogram:
+// exact below 16ns, then 16 buckets per power of two (within ~6%) up to ~4.3 seconds
+#define PACKET_STATS_SUB_BITS 4
+#define PACKET_STATS_SUB_BUCKETS (1 << PACKET_STATS_SUB_BITS)
+#define PACKET_STATS_MAX_BITS 32
+#define PACKET_STATS_BUCKETS ((PACKET_STATS_MAX_BITS - PACKET_STATS_SUB_BITS + 1) * PACKET_STATS_SUB_BUCKETS)
+
+// everything counted for one packet type, summed over every thread
+typedef struct {
+    uint64_t packetsIn;
+    uint64_t bytesIn;
+    uint64_t packetsOut;
+    uint64_t bytesOut;
+    uint64_t parseErrors;
+    uint64_t receiveErrors;
+    uint64_t latencySumNs;
+    uint64_t latency[PACKET_STATS_BUCKETS];
+} PacketTypeStats;
+
+// what a run of encoded packets of one type adds to the sent counters,
+// worked out once so sending the same bytes again is counted in one step
+typedef struct {
+    uint16_t type;
+    uint64_t packets;
+    uint64_t bytes;
+} PacketCount;
+
+// Counters and latency histograms for every MPacketType.
+// Each thread records into its own slab, so recording never takes a lock or
+// contends on a cache line, and a snapshot sums the slabs of every thread.
+// Unknown packet types are counted under MPACKET_NONE.
+class PacketStats {
+    public:
+        static uint64_t NowNs();
+
+        // a packet made it through MPacket::Process, aNs is the time spent parsing and handling it
+        static void Received(uint16_t aType, uint64_t aBytes, uint64_t aNs, bool aError);
+        static void ParseError(uint16_t aType, uint64_t aBytes);
+        static void Sent(uint16_t aType, uint64_t aPackets, uint64_t aBytes);
+        static void Sent(const std::vector<PacketCount>& aCounts);
+        static void Count(std::vector<PacketCount>& aCounts, uint16_t aType, uint64_t aBytes);
+
+        // one entry per MPacketType
+        static void Snapshot(std::vector<PacketTypeStats>& aStats);
+        static uint64_t Percentile(const PacketTypeStats& aStats, double aPercentile);
+        static const char* Name(uint16_t aType);
+
+        // a human readable table of every packet type seen so far
+        static std::string Format();
+
+        static size_t Bucket(uint64_t aNs);
+        static uint64_t BucketValue(size_t aBucket);
+};
@@ -0,0 +1,204 @@
+#include <thread>
+#include <chrono>
+#include <vector>
+#include "reactor.hpp"
+#include "logging.hpp"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+static uint32_t sEpollEvents(uint32_t aEvents) {
+    uint32_t events = EPOLLET | EPOLLRDHUP;
+    if (aEvents & REACTOR_READ)  { events |= EPOLLIN; }
+    if (aEvents & REACTOR_WRITE) { events |= EPOLLOUT; }
+    return events;
+}
+
+Reactor::Reactor() {
+}
+
+Reactor::~Reactor() {
+    if (mWakeFd >= 0) {
+        close(mWakeFd);
+        mWakeFd = -1;
+    }
+    if (mEpoll >= 0) {
+        close(mEpoll);
+        mEpoll = -1;
+    }
+}
+
+bool Reactor::Begin() {
+    mEpoll = epoll_create1(EPOLL_CLOEXEC);
+    if (mEpoll < 0) {
+        LOG_ERROR("Failed to create epoll (%d)!", SOCKET_LAST_ERROR);
+        return false;
+    }
+
+    mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mWakeFd < 0) {
+        LOG_ERROR("Failed to create eventfd (%d)!", SOCKET_LAST_ERROR);
+        return false;
+    }
+
+    return Add(mWakeFd, REACTOR_WAKE_ID, REACTOR_READ);
+}
+
+bool Reactor::Add(int aSocket, uint64_t aId, uint32_t aEvents) {
+    struct epoll_event ev = { 0 };
+    ev.events = sEpollEvents(aEvents);
+    ev.data.u64 = aId;
+    if (epoll_ctl(mEpoll, EPOLL_CTL_ADD, aSocket, &ev) != 0) {
+        LOG_ERROR("[%" PRIu64 "] Failed to add socket to epoll (%d)!", aId, SOCKET_LAST_ERROR);
+        return false;
+    }
+    return true;
+}
+
+bool Reactor::Modify(int aSocket, uint64_t aId, uint32_t aEvents) {
+    struct epoll_event ev = { 0 };
+    ev.events = sEpollEvents(aEvents);
+    ev.data.u64 = aId;
+    if (epoll_ctl(mEpoll, EPOLL_CTL_MOD, aSocket, &ev) != 0) {
+        LOG_ERROR("[%" PRIu64 "] Failed to modify socket in epoll (%d)!", aId, SOCKET_LAST_ERROR);
+        return false;
+    }
+    return true;
+}
+
+void Reactor::Remove(int aSocket) {
+    struct epoll_event ev = { 0 };
+    epoll_ctl(mEpoll, EPOLL_CTL_DEL, aSocket, &ev);
+}
+
+void Reactor::Wake() {
+    uint64_t value = 1;
+    if (write(mWakeFd, &value, sizeof(value)) < 0) {
+        // already signaled
+    }
+}
+
+int Reactor::Wait(ReactorEvent* aEvents, int aMaxEvents, int aTimeoutMs) {
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    if (aMaxEvents > REACTOR_MAX_EVENTS) { aMaxEvents = REACTOR_MAX_EVENTS; }
+
+    int count = epoll_wait(mEpoll, events, aMaxEvents, aTimeoutMs);
+    if (count < 0) {
+        if (SOCKET_LAST_ERROR != EINTR) {
+            LOG_ERROR("epoll_wait failed (%d)!", SOCKET_LAST_ERROR);
+        }
+        return 0;
+    }
+
+    int reported = 0;
+    for (int i = 0; i < count; i++) {
+        // reset the wakeup counter, the caller only cares that Wait() returned
+        if (events[i].data.u64 == REACTOR_WAKE_ID) {
+            uint64_t value = 0;
+            while (read(mWakeFd, &value, sizeof(value)) > 0) { }
+            continue;
+        }
+
+        uint32_t flags = 0;
+        if (events[i].events & EPOLLIN)  { flags |= REACTOR_READ; }
+        if (events[i].events & EPOLLOUT) { flags |= REACTOR_WRITE; }
+        if (events[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) {
+            // let the owner read the socket so it notices the close
+            flags |= REACTOR_READ | REACTOR_CLOSE;
+        }
+        aEvents[reported].id = events[i].data.u64;
+        aEvents[reported].events = flags;
+        reported++;
+    }
+
+    return reported;
+}
+
+#else
+
+Reactor::Reactor() {
+    mWoken = false;
+}
+
+Reactor::~Reactor() {
+}
+
+bool Reactor::Begin() {
+    return true;
+}
+
+void Reactor::Wake() {
+    mWoken = true;
+}
+
+bool Reactor::Add(int aSocket, uint64_t aId, uint32_t aEvents) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    mEntries[aSocket] = { aId, aEvents };
+    return true;
+}
+
+bool Reactor::Modify(int aSocket, uint64_t aId, uint32_t aEvents) {
+    return Add(aSocket, aId, aEvents);
+}
+
+void Reactor::Remove(int aSocket) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    mEntries.erase(aSocket);
+}
+
+int Reactor::Wait(ReactorEvent* aEvents, int aMaxEvents, int aTimeoutMs) {
+    fd_set readSet;
+    fd_set writeSet;
+    FD_ZERO(&readSet);
+    FD_ZERO(&writeSet);
+    int maxSocket = -1;
+    std::vector<std::pair<int, ReactorEntry>> entries;
+
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        for (auto& it : mEntries) {
+#ifndef _WIN32
+            if (it.first >= FD_SETSIZE) { continue; }
+#endif
+            if (entries.size() >= FD_SETSIZE) { break; }
+            if (it.second.events & REACTOR_READ)  { FD_SET(it.first, &readSet); }
+            if (it.second.events & REACTOR_WRITE) { FD_SET(it.first, &writeSet); }
+            if (it.first > maxSocket) { maxSocket = it.first; }
+            entries.push_back(it);
+        }
+    }
+
+    // wait in short slices so Wake() is noticed
+    if (mWoken.exchange(false)) { aTimeoutMs = 0; }
+    if (aTimeoutMs > REACTOR_FALLBACK_WAKE_MS) { aTimeoutMs = REACTOR_FALLBACK_WAKE_MS; }
+
+    // select() refuses empty sets on some platforms
+    if (entries.empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(aTimeoutMs));
+        return 0;
+    }
+
+    struct timeval timeout;
+    timeout.tv_sec = aTimeoutMs / 1000;
+    timeout.tv_usec = (aTimeoutMs % 1000) * 1000;
+
+    int rc = select(maxSocket + 1, &readSet, &writeSet, nullptr, &timeout);
+    if (rc <= 0) { return 0; }
+
+    int count = 0;
+    for (auto& it : entries) {
+        if (count >= aMaxEvents) { break; }
+        uint32_t flags = 0;
+        if (FD_ISSET(it.first, &readSet))  { flags |= REACTOR_READ; }
+        if (FD_ISSET(it.first, &writeSet)) { flags |= REACTOR_WRITE; }
+        if (!flags) { continue; }
+        aEvents[count].id = it.second.id;
+        aEvents[count].events = flags;
+        count++;
+    }
+
+    return count;
+}
+
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <map>
+#include <atomic>
+#include "socket.hpp"
+
+#define REACTOR_READ  (1 << 0)
+#define REACTOR_WRITE (1 << 1)
+#define REACTOR_CLOSE (1 << 2)
+
+#define REACTOR_MAX_EVENTS 256
+
+// ids are SlotMap handles and SlotMap never hands out zero, so zero is safe for wakeups
+#define REACTOR_WAKE_ID 0
+
+// select() can't be interrupted, so the fallback checks for wakeups this often
+#define REACTOR_FALLBACK_WAKE_MS 10
+
+typedef struct {
+    uint64_t id;
+    uint32_t events;
+} ReactorEvent;
+
+// Waits on a set of sockets and only wakes up for the ones that are ready.
+// On linux this is an edge-triggered epoll set, so the owner must drain a
+// socket until it would block before waiting on it again.
+// Other platforms fall back to select().
+// Wake() may be called from any thread to interrupt a Wait().
+class Reactor {
+    private:
+#ifdef __linux__
+        int mEpoll = -1;
+        int mWakeFd = -1;
+#else
+        std::atomic<bool> mWoken;
+        typedef struct {
+            uint64_t id;
+            uint32_t events;
+        } ReactorEntry;
+        std::mutex mMutex;
+        std::map<int, ReactorEntry> mEntries;
+#endif
+
+    public:
+        Reactor();
+        ~Reactor();
+
+        bool Begin();
+        bool Add(int aSocket, uint64_t aId, uint32_t aEvents);
+        bool Modify(int aSocket, uint64_t aId, uint32_t aEvents);
+        void Remove(int aSocket);
+        void Wake();
+        int Wait(ReactorEvent* aEvents, int aMaxEvents, int aTimeoutMs);
+};
@@ -0,0 +1,76 @@
+#include <cstdlib>
+#include <cstring>
+#include "ringbuffer.hpp"
+#include "logging.hpp"
+
+RingBuffer::~RingBuffer() {
+    Clear();
+}
+
+bool RingBuffer::Grow(size_t aRequired) {
+    size_t capacity = (mCapacity > 0) ? mCapacity : RINGBUFFER_MIN_CAPACITY;
+    while (capacity < aRequired) { capacity *= 2; }
+
+    uint8_t* data = (uint8_t*)malloc(capacity);
+    if (!data) {
+        LOG_ERROR("Failed to grow ring buffer to %" PRIu64 "", (uint64_t)capacity);
+        return false;
+    }
+
+    // unwrap the existing contents to the front of the new buffer
+    size_t first = mCapacity - mHead;
+    if (first > mSize) { first = mSize; }
+    if (first > 0) { memcpy(data, &mData[mHead], first); }
+    if (mSize > first) { memcpy(&data[first], mData, mSize - first); }
+
+    free(mData);
+    mData = data;
+    mCapacity = capacity;
+    mHead = 0;
+    return true;
+}
+
+bool RingBuffer::Write(const uint8_t* aData, size_t aSize) {
+    // nothing is written unless all of it fits
+    if (mSize + aSize > mCapacity && !Grow(mSize + aSize)) {
+        return false;
+    }
+
+    size_t tail = (mHead + mSize) & (mCapacity - 1);
+    size_t first = mCapacity - tail;
+    if (first > aSize) { first = aSize; }
+    memcpy(&mData[tail], aData, first);
+    if (aSize > first) { memcpy(mData, &aData[first], aSize - first); }
+    mSize += aSize;
+    return true;
+}
+
+size_t RingBuffer::Peek(const uint8_t** aData) {
+    if (mSize == 0) {
+        *aData = nullptr;
+        return 0;
+    }
+
+    // only the contiguous part, the caller comes back for the wrapped part
+    size_t first = mCapacity - mHead;
+    *aData = &mData[mHead];
+    return (first < mSize) ? first : mSize;
+}
+
+void RingBuffer::Consume(size_t aSize) {
+    // a burst shouldn't leave its memory behind for the rest of the connection's life
+    if (aSize >= mSize) {
+        Clear();
+        return;
+    }
+    mHead = (mHead + aSize) & (mCapacity - 1);
+    mSize -= aSize;
+}
+
+void RingBuffer::Clear() {
+    free(mData);
+    mData = nullptr;
+    mCapacity = 0;
+    mHead = 0;
+    mSize = 0;
+}
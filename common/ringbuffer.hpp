@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#define RINGBUFFER_MIN_CAPACITY 4096
+
+// A growable byte queue, reads come out in the order they were written.
+// The capacity is always a power of two so wrapping is a mask.
+// The memory is given back whenever it drains, an empty buffer holds nothing.
+class RingBuffer {
+    private:
+        uint8_t* mData = nullptr;
+        size_t mCapacity = 0;
+        size_t mHead = 0;
+        size_t mSize = 0;
+
+        bool Grow(size_t aRequired);
+
+    public:
+        RingBuffer() {}
+        RingBuffer(const RingBuffer&) = delete;
+        RingBuffer& operator=(const RingBuffer&) = delete;
+        ~RingBuffer();
+
+        size_t Size() { return mSize; }
+        size_t Capacity() { return mCapacity; }
+
+        bool Write(const uint8_t* aData, size_t aSize);
+        size_t Peek(const uint8_t** aData);
+        void Consume(size_t aSize);
+        void Clear();
+};
@@ -11,6 +11,9 @@
 #include "connection.hpp"
 #include "mpacket.hpp"
 #include "utils.hpp"
+#include "reactor.hpp"
+#include "coarseclock.hpp"
+#include "packetstats.hpp"
 
 #define MAX_LOBBY_SIZE 16
 
@@ -33,7 +36,12 @@ static void sOnLobbyLeave(Lobby* lobby, Connection* connection) { gServer->OnLob
 static void sOnLobbyDestroy(Lobby* lobby) { gServer->OnLobbyDestroy(lobby); }
 
 static void sReceiveStart(Server* server) { server->Receive(); }
-static void sUpdateStart(Server* server)  { server->Update(); }
+
+Server::Server() {
+    mBanGeneration = 0;
+    mLobbyCount = 0;
+    mPlayerCount = 0;
+}
 
 void Server::ReadTurnServers() {
     mTurnServers.clear();
@@ -64,14 +72,7 @@ void Server::ReadTurnServers() {
     input.close();
 }
 
-bool Server::Begin(uint32_t aPort) {
-    // read TURN servers
-    ReadTurnServers();
-
-    // Use a PRNG to generate a random seed
-    mPrng1 = std::mt19937_64(std::chrono::steady_clock::now().time_since_epoch().count() + 100);
-    mPrng2 = std::mt19937_64(std::chrono::steady_clock::now().time_since_epoch().count() + 500);
-
+bool Server::Listen(uint32_t aPort) {
     // create a master socket
     mSocket = SocketInitialize(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (mSocket <= 0) {
@@ -101,17 +102,57 @@ bool Server::Begin(uint32_t aPort) {
 
     LOG_INFO("Listener on port %d", aPort);
 
-    // try to specify maximum of 5 pending connections for the master socket
-    if (listen(mSocket, 5) < 0) {
+    // let a burst of connects queue up instead of having their SYNs dropped
+    if (listen(mSocket, SOMAXCONN) < 0) {
         LOG_ERROR("Master socket failed to listen!");
         return false;
     }
 
+    return true;
+}
+
+bool Server::Begin(uint32_t aPort, uint32_t aWorkers, uint32_t aAdmissionThreads) {
+    // read TURN servers
+    ReadTurnServers();
+
+    // Use a PRNG to generate a random seed
+    mPrng1 = std::mt19937_64(std::chrono::steady_clock::now().time_since_epoch().count() + 100);
+    mPrng2 = std::mt19937_64(std::chrono::steady_clock::now().time_since_epoch().count() + 500);
+
+    // without a port, connections can only be opened in-process
+    if (aPort != 0 && !Listen(aPort)) {
+        return false;
+    }
+
+    // create the workers, each one owns a shard of the connections
+    aWorkers = clamp<uint32_t>(aWorkers, 1, SERVER_MAX_WORKERS);
+    for (uint32_t i = 0; i < aWorkers; i++) {
+        Worker* worker = new Worker();
+        if (!worker->Begin(i)) {
+            LOG_ERROR("Failed to start worker %u!", i);
+            return false;
+        }
+        mWorkers.push_back(worker);
+    }
+    LOG_INFO("Started %u workers", aWorkers);
+
+    // new connections are checked off the accept thread, open ones off their worker
+    if (!mAdmission.Begin(aAdmissionThreads,
+            [this](Connection* aConnection, bool aAllowed) { ConnectionAdmit(aConnection, aAllowed); },
+            [this](uint64_t aConnectionId, bool aAllowed) {
+                if (aAllowed) { return; }
+                LOG_INFO("[%" PRIu64 "] Connection banned", aConnectionId);
+                QueueDisconnect(aConnectionId);
+            })) {
+        LOG_ERROR("Failed to start admission checks!");
+        return false;
+    }
+
     // create threads
-    mThreadRecv = std::thread(sReceiveStart, this);
-    mThreadRecv.detach();
-    mThreadUpdate = std::thread(sUpdateStart, this);
-    mThreadUpdate.detach();
+    if (aPort != 0) {
+        mThreadRecv = std::thread(sReceiveStart, this);
+        mThreadRecv.detach();
+    }
 
     // setup callbacks
     gOnLobbyJoin = sOnLobbyJoin;
@@ -125,182 +166,199 @@ void Server::Receive() {
     LOG_INFO("Waiting for connections...");
 
     while (true) {
-        // Get random connection id
-        uint64_t connectionId = mRng(mPrng1);
-        while (connectionId == 0 || mConnections.count(connectionId) > 0) {
-            connectionId = mRng(mPrng1);
-        }
-
         // accept the incoming connection
-        Connection* connection = new Connection(connectionId);
+        struct sockaddr_in address = { 0 };
         socklen_t len = sizeof(struct sockaddr_in);
-        connection->mSocket = accept(mSocket, (struct sockaddr *) &connection->mAddress, &len);
+        int socket = accept(mSocket, (struct sockaddr *) &address, &len);
 
         // make sure the connection worked
-        if (connection->mSocket < 0) {
-            LOG_ERROR("Failed to accept socket (%d)!", connection->mSocket);
-            delete connection;
+        if (socket < 0) {
+            LOG_ERROR("Failed to accept socket (%d)!", socket);
             continue;
         }
 
+        // this thread may have slept through a lot, the new connection starts its timers now
+        CoarseClockUpdate();
+
+        ConnectionOpen(new SocketTransport(socket), &address);
+    }
+}
+
+Connection* Server::ConnectionOpen(Transport* aTransport, const struct sockaddr_in* aAddress) {
+    Connection* connection = nullptr;
+    {
+        // connections may also be opened in-process, next to the accept thread
+        std::lock_guard<std::mutex> guard(mOpenMutex);
+
+        // Get random connection id
+        uint64_t connectionId = mRng(mPrng1);
+        while (connectionId == 0 || ConnectionGet(connectionId) != nullptr || mAdmission.Pending(connectionId)) {
+            connectionId = mRng(mPrng1);
+        }
+
+        connection = new Connection(connectionId);
+        connection->mTransport = aTransport;
+        if (aAddress) {
+            connection->mAddress = *aAddress;
+        }
+
         // start connection
         connection->Begin(gCoopNetCallbacks.DestIdFunction);
+        mBanIndex.Add(connection->mId, (uint64_t)connection->mAddress.sin_addr.s_addr, connection->mDestinationId);
 
-        // check if connection is allowed
-        if (gCoopNetCallbacks.ConnectionIsAllowed && !gCoopNetCallbacks.ConnectionIsAllowed(connection, true)) {
-            QueueDisconnect(connection->mId, true);
-        } else {
-            // send join packet
-            MPacketJoined({
-                .userId = connection->mId,
-                .version = MPACKET_PROTOCOL_VERSION
-            }).Send(*connection);
-
-            // send stun server
-            MPacketStunTurn(
-                { .isStun = true, .port = sStunServer.port },
-                { sStunServer.host, sStunServer.username, sStunServer.password }
-            ).Send(*connection);
-
-            // send turn servers
-            std::shuffle(mTurnServers.begin(), mTurnServers.end(), mPrng1);
-            for (auto& it : mTurnServers) {
-                MPacketStunTurn(
-                    { .isStun = false, .port = it.port },
-                    { it.host, it.username, it.password }
-                ).Send(*connection);
+        // the check may be slow, so it waits its turn without holding up the next accept
+        if (gCoopNetCallbacks.ConnectionIsAllowed) {
+            if (!mAdmission.Push(connection)) {
+                ConnectionAdmit(connection, false);
             }
+            return connection;
         }
-        // remember connection
-        std::lock_guard<std::mutex> guard(mConnectionsMutex);
-        mConnections[connection->mId] = connection;
-        LOG_INFO("[%" PRIu64 "] Connection added, count: %" PRIu64 "", connection->mId, (uint64_t)mConnections.size());
     }
-}
-
-void Server::Update() {
-    while (true) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        std::lock_guard<std::mutex> guard(mConnectionsMutex);
-        int players = 0;
-        size_t queueDisconnectCount = mQueueDisconnects.size();
-        for (auto it = mConnections.begin(); it != mConnections.end(); ) {
-            Connection* connection = it->second;
-            // erase the connection if it's inactive, otherwise receive packets
-            if (connection == nullptr) {
-                it = mConnections.erase(it);
-                continue;
-            }
 
-            if (!connection->mActive) {
-                LOG_INFO("[%" PRIu64 "] Connection removed, count: %" PRIu64 "", connection->mId, (uint64_t)mConnections.size());
-                delete connection;
-                it = mConnections.erase(it);
-                continue;
-            } else {
-                connection->Receive();
-                connection->Update();
-                if (connection->mLobby != nullptr) {
-                    players++;
-                }
-            }
+    ConnectionAdmit(connection, true);
+    return connection;
+}
 
-            std::chrono::system_clock::time_point nowTp = std::chrono::system_clock::now();
-            uint64_t now = std::chrono::system_clock::to_time_t(nowTp);
+void Server::ConnectionAdmit(Connection* aConnection, bool aAllowed) {
+    if (aAllowed) {
+        // send join packet
+        MPacketJoined({
+            .userId = aConnection->mId,
+            .version = MPACKET_PROTOCOL_VERSION
+        }).Send(*aConnection);
 
-            if (mRefreshBans && gCoopNetCallbacks.ConnectionIsAllowed && !gCoopNetCallbacks.ConnectionIsAllowed(connection, false)) {
-                connection->Disconnect(true);
-            } else if (mQueueDisconnects.count(connection->mId) > 0) {
-                connection->Disconnect(true);
-            } else if ((now - connection->mLastReceiveTime) > CONNECTION_DEAD_SECS) {
-                LOG_INFO("[%" PRIu64 "] Connection timeout", connection->mId);
-                connection->Disconnect(true);
-            }
+        // send stun server
+        MPacketStunTurn(
+            { .isStun = true, .port = sStunServer.port },
+            { sStunServer.host, sStunServer.username, sStunServer.password }
+        ).Send(*aConnection);
 
-            ++it;
+        // send turn servers, several admission threads may get here at once
+        std::vector<StunTurnServer> turnServers;
+        {
+            std::lock_guard<std::mutex> guard(mOpenMutex);
+            std::shuffle(mTurnServers.begin(), mTurnServers.end(), mPrng1);
+            turnServers = mTurnServers;
         }
+        for (auto& it : turnServers) {
+            MPacketStunTurn(
+                { .isStun = false, .port = it.port },
+                { it.host, it.username, it.password }
+            ).Send(*aConnection);
+        }
+    }
 
-        if (queueDisconnectCount == mQueueDisconnects.size()) {
-            mQueueDisconnects.clear();
+    {
+        // hand the connection over to the worker that owns its shard,
+        // the id stays reserved until then and a ban can't slip in between
+        std::lock_guard<std::mutex> guard(mHandoverMutex);
+        mWorkers[aConnection->mId % mWorkers.size()]->Adopt(aConnection);
+        if (mAdmission.Release(aConnection->mId) && aAllowed) {
+            // banned after its check ran, the disconnect BansAdd() queued found nobody
+            LOG_INFO("[%" PRIu64 "] Connection banned while being admitted", aConnection->mId);
+            aAllowed = false;
         }
+    }
 
-        mRefreshBans = false;
-        mPlayerCount = players;
+    if (!aAllowed) {
+        QueueDisconnect(aConnection->mId);
+    }
+}
 
-        // clear null lobbies
-        for (auto it = mLobbies.begin(); it != mLobbies.end(); ) {
-            Lobby* lobby = it->second;
-            if (!lobby) {
-                it = mLobbies.erase(it);
-                continue;
-            }
-            ++it;
-        }
+void Server::ConnectionInfoBits(Connection* aConnection, uint64_t aInfoBits) {
+    mBanIndex.Move(BAN_KEY_INFO_BITS, aConnection->mId, aConnection->mInfoBits, aInfoBits);
+    aConnection->mInfoBits = aInfoBits;
+}
 
-        ReputationUpdate();
+void Server::ConnectionForget(Connection* aConnection) {
+    mBanIndex.Remove(aConnection->mId, (uint64_t)aConnection->mAddress.sin_addr.s_addr, aConnection->mDestinationId, aConnection->mInfoBits);
+}
 
-        fflush(stdout);
-        fflush(stderr);
-    }
+void Server::ConnectionRecheck(Connection* aConnection) {
+    mAdmission.Recheck(aConnection);
+}
+
+size_t Server::ConnectionPendingCount() {
+    return mAdmission.Count();
+}
+
+void Server::Housekeeping() {
+    fflush(stdout);
+    fflush(stderr);
 }
 
 Connection *Server::ConnectionGet(uint64_t aUserId) {
-    return mConnections[aUserId];
+    // connections owned by other workers may only be used while holding mLobbiesMutex
+    std::lock_guard<std::recursive_mutex> guard(mLobbiesMutex);
+    return mWorkers[aUserId % mWorkers.size()]->ConnectionGet(aUserId);
+}
+
+bool Server::ConnectionPost(uint64_t aUserId, WorkerTask aTask) {
+    // a connection that isn't there is reported right away,
+    // one that closes before its worker gets to the task just drops it
+    Worker* worker = mWorkers[aUserId % mWorkers.size()];
+    {
+        std::lock_guard<std::recursive_mutex> guard(mLobbiesMutex);
+        Connection* connection = worker->ConnectionGet(aUserId);
+        if (!connection || !connection->mActive) { return false; }
+    }
+    worker->Post(aUserId, aTask);
+    return true;
 }
 
 Lobby* Server::LobbyGet(uint64_t aLobbyId) {
-    return mLobbies[aLobbyId];
-}
-
-void Server::LobbyListGet(Connection& aConnection, std::string aGame, std::string aPassword) {
-    for (auto& it : mLobbies) {
-        if (!it.second) { continue; }
-        if (it.second->mGame != aGame) { continue; }
-        if (it.second->mPassword != aPassword) { continue; }
-
-        MPacketLobbyListGot({
-            .lobbyId = it.first,
-            .ownerId = it.second->mOwner->mId,
-            .connections = (uint16_t)it.second->mConnections.size(),
-            .maxConnections = it.second->mMaxConnections
-        }, {
-            it.second->mGame,
-            it.second->mVersion,
-            it.second->mHostName,
-            it.second->mMode,
-            it.second->mDescription,
-        }).Send(aConnection);
+    // an unknown id is just not found, nothing gets added for it
+    Lobby** lobby = mLobbies.Find(aLobbyId);
+    return lobby ? *lobby : nullptr;
+}
+
+void Server::LobbyListGet(Connection& aConnection, const StringView& aGame, const StringView& aPassword) {
+    // the directory keeps the encoded response until one of its lobbies changes,
+    // a busy game's list may be bigger than the outbound budget on its own
+    std::shared_ptr<LobbyDirectoryList> list = mDirectory.List(aGame, aPassword);
+
+    // shares ownership with the list, so the bytes can be posted without a copy
+    std::shared_ptr<std::string> bytes(list, &list->bytes);
+    if (MPacket::SendEncoded(aConnection, (const uint8_t*)bytes->data(), (int64_t)bytes->size(), bytes, true)) {
+        PacketStats::Sent(list->counts);
     }
-    MPacketLobbyListFinish({ 0 }).Send(aConnection);
 }
 
 void Server::OnLobbyJoin(Lobby* aLobby, Connection* aConnection) {
     if (!aLobby || !aConnection) { return; }
+    mDirectory.Invalidate(aLobby);
+    CountsAdd(aLobby->mGame, 0, 1);
     if (gCoopNetCallbacks.LobbyConnectionIsAllowed && !gCoopNetCallbacks.LobbyConnectionIsAllowed(aConnection, aLobby)) { return; }
     MPacketLobbyJoined({
         .lobbyId = aLobby->mId,
         .userId = aConnection->mId,
-        .ownerId = aLobby->mOwner->mId,
+        .ownerId = aLobby->mOwner.id,
         .destId = aConnection->mDestinationId,
         .priority = aConnection->mPriority
     }).Send(*aLobby);
 
     // inform joiner of other connections
     for (auto& it : aLobby->mConnections) {
-        if (it->mId == aConnection->mId) {
+        if (it.id == aConnection->mId) {
+            continue;
+        }
+        Connection* member = ConnectionTable::Resolve(it);
+        if (!member) {
             continue;
         }
         MPacketLobbyJoined({
             .lobbyId = aLobby->mId,
-            .userId = it->mId,
-            .ownerId = aLobby->mOwner->mId,
-            .destId = it->mDestinationId,
-            .priority = it->mPriority
+            .userId = member->mId,
+            .ownerId = aLobby->mOwner.id,
+            .destId = member->mDestinationId,
+            .priority = member->mPriority
         }).Send(*aConnection);
     }
 }
 
 void Server::OnLobbyLeave(Lobby* aLobby, Connection* aConnection) {
+    mDirectory.Invalidate(aLobby);
+    CountsAdd(aLobby->mGame, 0, -1);
     MPacketLobbyLeft({
         .lobbyId = aLobby->mId,
         .userId = aConnection->mId
@@ -308,12 +366,14 @@ void Server::OnLobbyLeave(Lobby* aLobby, Connection* aConnection) {
 }
 
 void Server::OnLobbyDestroy(Lobby* aLobby) {
-    mLobbies.erase(aLobby->mId);
-    mLobbyCount--;
-    LOG_INFO("[%" PRIu64 "] Lobby removed, count: %" PRIu64 "", aLobby->mId, (uint64_t)mLobbies.size());
+    mLobbies.Remove(aLobby->mHandle);
+    aLobby->mHandle = 0;
+    mDirectory.Remove(aLobby);
+    CountsAdd(aLobby->mGame, -1, 0);
+    LOG_INFO("[%" PRIu64 "] Lobby removed, count: %" PRIu64 "", aLobby->mId, (uint64_t)mLobbies.Size());
 }
 
-void Server::LobbyCreate(Connection* aConnection, std::string& aGame, std::string& aVersion, std::string& aHostName, std::string& aMode, uint16_t aMaxConnections, std::string& aPassword, std::string &aDescription) {
+void Server::LobbyCreate(Connection* aConnection, const StringView& aGame, const StringView& aVersion, const StringView& aHostName, const StringView& aMode, uint16_t aMaxConnections, const StringView& aPassword, const StringView& aDescription) {
     // check if this connection already has a lobby
     if (aConnection->mLobby) {
         aConnection->mLobby->Leave(aConnection);
@@ -321,12 +381,12 @@ void Server::LobbyCreate(Connection* aConnection, std::string& aGame, std::strin
 
     // Get random lobby id
     uint64_t lobbyId = mRng(mPrng2);
-    while (lobbyId == 0 || mLobbies.count(lobbyId) > 0) {
+    while (lobbyId == 0 || mLobbies.Find(lobbyId) != nullptr) {
         lobbyId = mRng(mPrng2);
     }
 
     // limit the lobby size
-    if (aPassword == "" && aMaxConnections > MAX_LOBBY_SIZE) {
+    if (aPassword.Empty() && aMaxConnections > MAX_LOBBY_SIZE) {
         aMaxConnections = MAX_LOBBY_SIZE;
     }
 
@@ -341,9 +401,11 @@ void Server::LobbyCreate(Connection* aConnection, std::string& aGame, std::strin
         aPassword,
         aDescription);
 
-    mLobbies[lobby->mId] = lobby;
+    lobby->mHandle = mLobbies.Insert(lobby->mId, lobby);
+    mDirectory.Add(lobby);
+    CountsAdd(lobby->mGame, 1, 0);
 
-    LOG_INFO("[%" PRIu64 "] Lobby added, count: %" PRIu64 "", lobby->mId, (uint64_t)mLobbies.size());
+    LOG_INFO("[%" PRIu64 "] Lobby added, count: %" PRIu64 "", lobby->mId, (uint64_t)mLobbies.Size());
 
     // notify of lobby creation
     MPacketLobbyCreated({
@@ -357,25 +419,46 @@ void Server::LobbyCreate(Connection* aConnection, std::string& aGame, std::strin
     }).Send(*aConnection);
 
     lobby->Join(aConnection, aPassword);
-    mLobbyCount++;
 }
 
-void Server::LobbyUpdate(Connection *aConnection, uint64_t aLobbyId, std::string &aGame, std::string &aVersion, std::string &aHostName, std::string &aMode, std::string &aDescription) {
+void Server::LobbyUpdate(Connection *aConnection, uint64_t aLobbyId, const StringView& aGame, const StringView& aVersion, const StringView& aHostName, const StringView& aMode, const StringView& aDescription) {
     Lobby* lobby = LobbyGet(aLobbyId);
     if (!lobby) {
         LOG_ERROR("Could not find lobby to update: %" PRIu64 "", aLobbyId);
         return;
     }
-    if (lobby->mOwner != aConnection) {
+    if (!lobby->IsOwner(aConnection)) {
         LOG_ERROR("Could not update lobby, was not the owner: %" PRIu64 "", aLobbyId);
         return;
     }
 
-    lobby->mGame = aGame.substr(0, 32);
-    lobby->mVersion = aVersion.substr(0, 32);
-    lobby->mHostName = aHostName.substr(0, 32);
-    lobby->mMode = aMode.substr(0, 32);
-    lobby->mDescription = aDescription.substr(0, 256);
+    // the lobby and everyone in it move over to the new game
+    if (aGame != lobby->mGame) {
+        int players = (int)lobby->mConnections.size();
+        CountsAdd(lobby->mGame, -1, -players);
+        CountsAdd(aGame.ToString(), 1, players);
+    }
+
+    lobby->mGame = aGame.ToString();
+    lobby->mVersion = aVersion.ToString();
+    lobby->mHostName = aHostName.ToString();
+    lobby->mMode = aMode.ToString();
+    lobby->mDescription = aDescription.ToString();
+    mDirectory.Update(lobby);
+}
+
+void Server::CountsAdd(const std::string& aGame, int aLobbies, int aPlayers) {
+    // lobby changes already hold the lobby mutex, the game map has its own so readers don't need it
+    mLobbyCount += aLobbies;
+    mPlayerCount += aPlayers;
+
+    std::lock_guard<std::mutex> guard(mGameCountsMutex);
+    GameCount& count = mGameCounts[aGame];
+    count.lobbies += aLobbies;
+    count.players += aPlayers;
+    if (count.lobbies <= 0 && count.players <= 0) {
+        mGameCounts.erase(aGame);
+    }
 }
 
 int Server::PlayerCount() {
@@ -386,70 +469,102 @@ int Server::LobbyCount() {
     return mLobbyCount;
 }
 
-void Server::QueueDisconnect(uint64_t aUserId, bool aLockMutex) {
-    if (aLockMutex) {
-        std::lock_guard<std::mutex> guard(mConnectionsMutex);
-        if (mQueueDisconnects.count(aUserId)) { return; }
-        mQueueDisconnects.insert(aUserId);
-    } else {
-        if (mQueueDisconnects.count(aUserId)) { return; }
-        mQueueDisconnects.insert(aUserId);
-    }
+void Server::GameCounts(std::map<std::string, GameCount>& aCounts) {
+    std::lock_guard<std::mutex> guard(mGameCountsMutex);
+    aCounts = mGameCounts;
+}
+
+void Server::QueueDisconnect(uint64_t aUserId) {
+    // the owning worker disconnects it the next time it drains its queue,
+    // this may run before it has been adopted so it's posted without a lookup
+    mWorkers[aUserId % mWorkers.size()]->Post(aUserId, [](Connection& aConnection) {
+        aConnection.Disconnect(true);
+    });
 }
 
 void Server::RefreshBans() {
-    std::lock_guard<std::mutex> guard(mConnectionsMutex);
-    mRefreshBans = true;
+    // every worker re-checks all of its connections when it sees a new generation,
+    // new bans that can be named are much cheaper through BansAdd()
+    mBanGeneration++;
+}
+
+void Server::BansAdd(const std::vector<std::string>& aAddresses, const std::vector<uint64_t>& aDestIds, const std::vector<uint64_t>& aInfoBits) {
+    // only the connections the new bans name are touched, the ban list itself
+    // has to be updated first so connections still being admitted see it
+    std::vector<uint64_t> banned;
+    for (auto& it : aAddresses) {
+        struct in_addr address = { 0 };
+        if (inet_pton(AF_INET, it.c_str(), &address) != 1) {
+            LOG_ERROR("Could not parse banned address: %s", it.c_str());
+            continue;
+        }
+        mBanIndex.Find(BAN_KEY_ADDRESS, (uint64_t)address.s_addr, banned);
+    }
+    for (auto& it : aDestIds) {
+        mBanIndex.Find(BAN_KEY_DEST_ID, it, banned);
+    }
+    for (auto& it : aInfoBits) {
+        mBanIndex.Find(BAN_KEY_INFO_BITS, it, banned);
+    }
+
+    // one connection may match more than one ban
+    std::sort(banned.begin(), banned.end());
+    banned.erase(std::unique(banned.begin(), banned.end()), banned.end());
+    for (auto& it : banned) {
+        LOG_INFO("[%" PRIu64 "] Connection banned", it);
+
+        // one that's still being admitted has no worker to post to yet,
+        // ConnectionAdmit() turns it away once it's handed over
+        std::lock_guard<std::mutex> guard(mHandoverMutex);
+        mAdmission.Ban(it);
+        QueueDisconnect(it);
+    }
+}
+
+uint64_t Server::BanGeneration() {
+    return mBanGeneration;
 }
 
 void Server::ReputationIncrease(uint64_t aDestinationId) {
-    std::chrono::system_clock::time_point nowTp = std::chrono::system_clock::now();
-    uint64_t now = std::chrono::system_clock::to_time_t(nowTp);
+    std::lock_guard<std::recursive_mutex> guard(mLobbiesMutex);
+    uint64_t now = CoarseClockNow();
 
-    if (mReputation.count(aDestinationId) == 0) {
-        mReputation[aDestinationId] = { 1, now };
+    struct Reptuation* reputation = mReputation.Find(aDestinationId);
+    if (!reputation) {
+        reputation = mReputation.Insert(aDestinationId, { 1, now });
     } else {
-        mReputation[aDestinationId].value = clamp(mReputation[aDestinationId].value + 1, -16, 16);
-        mReputation[aDestinationId].timestamp = now;
+        reputation->value = clamp(reputation->value + 1, -16, 16);
+        reputation->timestamp = now;
     }
-    LOG_INFO("Reputation increase: destId %" PRIu64 " -> %d", aDestinationId, mReputation[aDestinationId].value);
+    LOG_INFO("Reputation increase: destId %" PRIu64 " -> %d", aDestinationId, reputation->value);
 }
 
 void Server::ReputationDecrease(uint64_t aDestinationId) {
-    std::chrono::system_clock::time_point nowTp = std::chrono::system_clock::now();
-    uint64_t now = std::chrono::system_clock::to_time_t(nowTp);
+    std::lock_guard<std::recursive_mutex> guard(mLobbiesMutex);
+    uint64_t now = CoarseClockNow();
 
-    if (mReputation.count(aDestinationId) == 0) {
-        mReputation[aDestinationId] = { -2, now };
+    struct Reptuation* reputation = mReputation.Find(aDestinationId);
+    if (!reputation) {
+        reputation = mReputation.Insert(aDestinationId, { -2, now });
     } else {
-        mReputation[aDestinationId].value = clamp(mReputation[aDestinationId].value - 2, -16, 16);
-        mReputation[aDestinationId].timestamp = now;
+        reputation->value = clamp(reputation->value - 2, -16, 16);
+        reputation->timestamp = now;
     }
-    LOG_INFO("Reputation decrease: destId %" PRIu64 " -> %d", aDestinationId, mReputation[aDestinationId].value);
+    LOG_INFO("Reputation decrease: destId %" PRIu64 " -> %d", aDestinationId, reputation->value);
 }
 
 int32_t Server::ReputationGet(uint64_t aDestinationId) {
-    if (mReputation.count(aDestinationId) == 0) {
-        return 0;
-    } else {
-        return mReputation[aDestinationId].value;
-    }
+    std::lock_guard<std::recursive_mutex> guard(mLobbiesMutex);
+    struct Reptuation* reputation = mReputation.Find(aDestinationId);
+    return reputation ? reputation->value : 0;
 }
 
 void Server::ReputationUpdate() {
-    static uint64_t sNextRepUpdateTime = 0;
-    std::chrono::system_clock::time_point nowTp = std::chrono::system_clock::now();
-    uint64_t now = std::chrono::system_clock::to_time_t(nowTp);
-
-    if (now < sNextRepUpdateTime) { return; }
-    sNextRepUpdateTime = now + 60 * 60 * 1;
+    // purges reputations nobody has touched in a day, the first worker calls this hourly
+    std::lock_guard<std::recursive_mutex> guard(mLobbiesMutex);
+    uint64_t now = CoarseClockNow();
 
-    for (auto it = mReputation.begin(); it != mReputation.end(); ) {
-        uint64_t timestamp = it->second.timestamp;
-        if ((now - timestamp) > 60 * 60 * 24) {
-            it = mReputation.erase(it);
-            continue;
-        }
-        ++it;
-    }
+    mReputation.EraseIf([now](uint64_t aDestinationId, struct Reptuation& aReputation) {
+        return (now - aReputation.timestamp) > 60 * 60 * 24;
+    });
 }
@@ -3,14 +3,31 @@
 #include <thread>
 #include <vector>
 #include <map>
+#include <string>
 #include <set>
 #include <mutex>
+#include <atomic>
 #include <random>
 #include <cstdint>
 #include <chrono>
 #include "socket.hpp"
 #include "connection.hpp"
 #include "lobby.hpp"
+#include "worker.hpp"
+#include "lobbydirectory.hpp"
+#include "admission.hpp"
+#include "banindex.hpp"
+#include "slotmap.hpp"
+#include "flatmap.hpp"
+
+#define SERVER_HOUSEKEEPING_MS 1000
+#define SERVER_MAX_WORKERS 64
+
+// players and lobbies of one game
+typedef struct {
+    int lobbies;
+    int players;
+} GameCount;
 
 struct Reptuation {
     int32_t value;
@@ -20,48 +37,69 @@ struct Reptuation {
 class Server {
     private:
         std::thread mThreadRecv;
-        std::thread mThreadUpdate;
-        int mSocket;
-        std::map<uint64_t, Connection*> mConnections;
-        std::mutex mConnectionsMutex;
-        std::map<uint64_t, Lobby*> mLobbies;
+        int mSocket = -1;
+        std::vector<Worker*> mWorkers;
+        SlotMap<Lobby*> mLobbies;
+        LobbyDirectory mDirectory;
         std::mt19937_64 mPrng1;
         std::mt19937_64 mPrng2;
         std::uniform_int_distribution<uint64_t> mRng;
         std::vector<StunTurnServer> mTurnServers;
-        std::set<uint64_t> mQueueDisconnects;
-        std::map<uint64_t, struct Reptuation> mReputation;
-        int mLobbyCount = 0;
-        int mPlayerCount = 0;
-        bool mRefreshBans = false;
+        FlatMap<struct Reptuation> mReputation;
+        std::atomic<int> mLobbyCount;
+        std::atomic<int> mPlayerCount;
+        std::map<std::string, GameCount> mGameCounts;
+        std::mutex mGameCountsMutex;
+        std::atomic<uint64_t> mBanGeneration;
+        std::mutex mOpenMutex;
+        std::mutex mHandoverMutex;
+        Admission mAdmission;
+        BanIndex mBanIndex;
 
         void ReadTurnServers();
-        void ReputationUpdate();
+        bool Listen(uint32_t aPort);
+        void CountsAdd(const std::string& aGame, int aLobbies, int aPlayers);
 
     public:
+        // guards the lobbies, lobby membership, reputation and the lifetime
+        // of connections owned by other workers
+        std::recursive_mutex mLobbiesMutex;
 
-        bool Begin(uint32_t aPort);
+        Server();
+
+        bool Begin(uint32_t aPort, uint32_t aWorkers = 1, uint32_t aAdmissionThreads = ADMISSION_DEFAULT_THREADS);
         void Receive();
-        void Update();
+        void Housekeeping();
 
+        Connection* ConnectionOpen(Transport* aTransport, const struct sockaddr_in* aAddress = nullptr);
+        void ConnectionAdmit(Connection* aConnection, bool aAllowed);
+        void ConnectionInfoBits(Connection* aConnection, uint64_t aInfoBits);
+        void ConnectionForget(Connection* aConnection);
+        void ConnectionRecheck(Connection* aConnection);
+        size_t ConnectionPendingCount();
         Connection* ConnectionGet(uint64_t aUserId);
+        bool ConnectionPost(uint64_t aUserId, WorkerTask aTask);
 
         Lobby* LobbyGet(uint64_t aLobbyId);
-        void LobbyListGet(Connection& aConnection, std::string aGame, std::string aPassword);
+        void LobbyListGet(Connection& aConnection, const StringView& aGame, const StringView& aPassword);
 
         void OnLobbyJoin(Lobby* aLobby, Connection* aConnection);
         void OnLobbyLeave(Lobby* aLobby, Connection* aConnection);
         void OnLobbyDestroy(Lobby* aLobby);
 
-        void LobbyCreate(Connection* aConnection, std::string& aGame, std::string& aVersion, std::string& aHostName, std::string& aMode, uint16_t aMaxConnections, std::string& aPassword, std::string& aDescription);
-        void LobbyUpdate(Connection* aConnection, uint64_t aLobbyId, std::string& aGame, std::string& aVersion, std::string& aHostName, std::string& aMode, std::string& aDescription);
+        void LobbyCreate(Connection* aConnection, const StringView& aGame, const StringView& aVersion, const StringView& aHostName, const StringView& aMode, uint16_t aMaxConnections, const StringView& aPassword, const StringView& aDescription);
+        void LobbyUpdate(Connection* aConnection, uint64_t aLobbyId, const StringView& aGame, const StringView& aVersion, const StringView& aHostName, const StringView& aMode, const StringView& aDescription);
 
         int PlayerCount();
         int LobbyCount();
+        void GameCounts(std::map<std::string, GameCount>& aCounts);
 
-        void QueueDisconnect(uint64_t aUserId, bool aLockMutex);
+        void QueueDisconnect(uint64_t aUserId);
         void RefreshBans();
+        void BansAdd(const std::vector<std::string>& aAddresses, const std::vector<uint64_t>& aDestIds, const std::vector<uint64_t>& aInfoBits);
+        uint64_t BanGeneration();
 
+        void ReputationUpdate();
         void ReputationIncrease(uint64_t aDestinationId);
         void ReputationDecrease(uint64_t aDestinationId);
         int32_t ReputationGet(uint64_t aDestinationId);
@@ -0,0 +1,59 @@
+#include <cstdlib>
+#include "slabpool.hpp"
+#include "logging.hpp"
+
+SlabPool::SlabPool(size_t aBlockSize, size_t aBlocksPerSlab) {
+    // every block has to be able to hold the free list link and keep its alignment
+    size_t align = alignof(std::max_align_t);
+    if (aBlockSize < sizeof(void*)) { aBlockSize = sizeof(void*); }
+    mBlockSize = (aBlockSize + align - 1) / align * align;
+    mBlocksPerSlab = (aBlocksPerSlab > 0) ? aBlocksPerSlab : 1;
+}
+
+SlabPool::~SlabPool() {
+    for (auto& it : mSlabs) {
+        free(it);
+    }
+}
+
+void* SlabPool::Alloc() {
+    std::lock_guard<std::mutex> guard(mMutex);
+
+    // out of blocks, carve up a new slab
+    if (!mFree) {
+        uint8_t* slab = (uint8_t*)malloc(mBlockSize * mBlocksPerSlab);
+        if (!slab) {
+            LOG_ERROR("Failed to allocate a slab of %" PRIu64 " bytes", (uint64_t)(mBlockSize * mBlocksPerSlab));
+            return nullptr;
+        }
+        mSlabs.push_back(slab);
+        for (size_t i = mBlocksPerSlab; i > 0; i--) {
+            void* block = &slab[(i - 1) * mBlockSize];
+            *(void**)block = mFree;
+            mFree = block;
+        }
+    }
+
+    void* block = mFree;
+    mFree = *(void**)block;
+    mUsed++;
+    return block;
+}
+
+void SlabPool::Free(void* aBlock) {
+    if (!aBlock) { return; }
+    std::lock_guard<std::mutex> guard(mMutex);
+    *(void**)aBlock = mFree;
+    mFree = aBlock;
+    mUsed--;
+}
+
+size_t SlabPool::Used() {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mUsed;
+}
+
+size_t SlabPool::Capacity() {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mSlabs.size() * mBlocksPerSlab;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <mutex>
+
+// Hands out fixed size blocks carved from large slabs, so many long lived
+// objects of one kind sit packed together instead of all over the heap.
+// Freed blocks go on a free list and are handed out again first, slabs are
+// never given back. Safe to use from any thread.
+class SlabPool {
+    private:
+        size_t mBlockSize = 0;
+        size_t mBlocksPerSlab = 0;
+        std::vector<uint8_t*> mSlabs;
+        void* mFree = nullptr;
+        size_t mUsed = 0;
+        std::mutex mMutex;
+
+    public:
+        SlabPool(size_t aBlockSize, size_t aBlocksPerSlab);
+        SlabPool(const SlabPool&) = delete;
+        SlabPool& operator=(const SlabPool&) = delete;
+        ~SlabPool();
+
+        void* Alloc();
+        void Free(void* aBlock);
+
+        size_t Used();
+        size_t Capacity();
+};
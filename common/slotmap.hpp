@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "flatmap.hpp"
+
+// index in the low half, generation in the high half, zero is never handed out
+typedef uint64_t SlotHandle;
+
+#define SLOT_HANDLE_INDEX(aHandle) ((uint32_t)((aHandle) & 0xFFFFFFFF))
+#define SLOT_HANDLE_GENERATION(aHandle) ((uint32_t)((aHandle) >> 32))
+
+// Values kept in reusable slots, reached either by a handle or by their 64-bit id.
+// A slot's generation moves on every time it's freed, so a handle that outlived
+// its value no longer matches and Get() returns nullptr instead of someone else's.
+// Looking something up never adds anything.
+// Not thread safe, the owner guards it.
+template <typename T>
+class SlotMap {
+    private:
+        typedef struct {
+            T value;
+            uint64_t id;
+            uint32_t generation;
+            uint32_t nextFree;
+            bool used;
+        } Slot;
+
+        std::vector<Slot> mSlots;
+        FlatMap<SlotHandle> mIds;
+        uint32_t mFreeHead = UINT32_MAX;
+
+    public:
+        SlotHandle Insert(uint64_t aId, const T& aValue) {
+            uint32_t index = mFreeHead;
+            if (index != UINT32_MAX) {
+                mFreeHead = mSlots[index].nextFree;
+            } else {
+                index = (uint32_t)mSlots.size();
+                mSlots.push_back({ T(), 0, 1, UINT32_MAX, false });
+            }
+
+            Slot& slot = mSlots[index];
+            slot.value = aValue;
+            slot.id = aId;
+            slot.used = true;
+
+            SlotHandle handle = ((uint64_t)slot.generation << 32) | index;
+            mIds.Insert(aId, handle);
+            return handle;
+        }
+
+        bool Remove(SlotHandle aHandle) {
+            if (!Get(aHandle)) { return false; }
+            Slot& slot = mSlots[SLOT_HANDLE_INDEX(aHandle)];
+            mIds.Erase(slot.id);
+            slot.value = T();
+            slot.used = false;
+
+            // skip zero so a handle is never zero
+            slot.generation++;
+            if (slot.generation == 0) { slot.generation = 1; }
+
+            slot.nextFree = mFreeHead;
+            mFreeHead = SLOT_HANDLE_INDEX(aHandle);
+            return true;
+        }
+
+        T* Get(SlotHandle aHandle) {
+            uint32_t index = SLOT_HANDLE_INDEX(aHandle);
+            if (index >= mSlots.size()) { return nullptr; }
+            Slot& slot = mSlots[index];
+            if (!slot.used || slot.generation != SLOT_HANDLE_GENERATION(aHandle)) { return nullptr; }
+            return &slot.value;
+        }
+
+        SlotHandle Handle(uint64_t aId) {
+            SlotHandle* handle = mIds.Find(aId);
+            return handle ? *handle : 0;
+        }
+
+        T* Find(uint64_t aId) {
+            SlotHandle* handle = mIds.Find(aId);
+            return handle ? &mSlots[SLOT_HANDLE_INDEX(*handle)].value : nullptr;
+        }
+
+        size_t Size() { return mIds.Size(); }
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+// A pointer and a length into someone else's string data.
+// Views handed out by MPacket point into the connection's receive buffer and
+// are only valid until the packet's Receive() returns, they are always
+// null terminated so they can be passed along as c strings.
+class StringView {
+    private:
+        const char* mData = "";
+        size_t mSize = 0;
+
+    public:
+        StringView() {}
+        StringView(const char* aData, size_t aSize) : mData(aData), mSize(aSize) {}
+        StringView(const std::string& aString) : mData(aString.c_str()), mSize(aString.size()) {}
+
+        const char* Data() const { return mData; }
+        size_t Size() const { return mSize; }
+        bool Empty() const { return mSize == 0; }
+        std::string ToString() const { return std::string(mData, mSize); }
+
+        bool operator==(const StringView& aOther) const {
+            return mSize == aOther.mSize && memcmp(mData, aOther.mData, mSize) == 0;
+        }
+        bool operator!=(const StringView& aOther) const { return !(*this == aOther); }
+};
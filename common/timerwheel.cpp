@@ -0,0 +1,70 @@
+#include "timerwheel.hpp"
+
+void TimerWheel::Begin(uint64_t aNow) {
+    mNow = aNow;
+}
+
+void TimerWheel::Place(const TimerEntry& aEntry, bool aCurrentTick) {
+    // anything that's already due goes off on the next tick, or on this one
+    // while it's being cascaded into place
+    uint64_t deadline = aEntry.deadline;
+    if (deadline <= mNow) {
+        deadline = aCurrentTick ? mNow : mNow + 1;
+        mSlots[0][deadline & TIMERWHEEL_SLOT_MASK].push_back(aEntry);
+        return;
+    }
+
+    // find the finest level that can reach the deadline,
+    // past the last level it waits there and gets placed again later
+    uint64_t delta = deadline - mNow;
+    int level = 0;
+    while (level < TIMERWHEEL_LEVELS - 1 && delta >= ((uint64_t)1 << (TIMERWHEEL_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    uint64_t maxDelta = ((uint64_t)1 << (TIMERWHEEL_SLOT_BITS * TIMERWHEEL_LEVELS)) - 1;
+    if (delta > maxDelta) { deadline = mNow + maxDelta; }
+
+    size_t slot = (deadline >> (TIMERWHEEL_SLOT_BITS * level)) & TIMERWHEEL_SLOT_MASK;
+    mSlots[level][slot].push_back(aEntry);
+}
+
+void TimerWheel::Schedule(uint64_t aDeadline, uint32_t aType, uint64_t aId, uint64_t aArg) {
+    Place({ .deadline = aDeadline, .type = aType, .id = aId, .arg = aArg }, false);
+    mCount++;
+}
+
+void TimerWheel::Advance(uint64_t aNow, std::vector<TimerEntry>& aDue) {
+    while (mNow < aNow) {
+        mNow++;
+
+        // whenever a level wraps around, spread the next slot of the level above over the finer ones
+        for (int level = 1; level < TIMERWHEEL_LEVELS; level++) {
+            uint64_t mask = ((uint64_t)1 << (TIMERWHEEL_SLOT_BITS * level)) - 1;
+            if ((mNow & mask) != 0) { break; }
+
+            size_t slot = (mNow >> (TIMERWHEEL_SLOT_BITS * level)) & TIMERWHEEL_SLOT_MASK;
+            mCascade.swap(mSlots[level][slot]);
+            for (auto& it : mCascade) {
+                Place(it, true);
+            }
+            mCascade.clear();
+        }
+
+        // fire everything in this tick's slot, timers parked on the last level may not be due yet
+        std::vector<TimerEntry>& due = mSlots[0][mNow & TIMERWHEEL_SLOT_MASK];
+        for (auto& it : due) {
+            if (it.deadline > mNow) {
+                mCascade.push_back(it);
+                continue;
+            }
+            aDue.push_back(it);
+            mCount--;
+        }
+        due.clear();
+
+        for (auto& it : mCascade) {
+            Place(it, false);
+        }
+        mCascade.clear();
+    }
+}
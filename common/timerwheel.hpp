@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#define TIMERWHEEL_LEVELS 4
+#define TIMERWHEEL_SLOT_BITS 6
+#define TIMERWHEEL_SLOTS (1 << TIMERWHEEL_SLOT_BITS)
+#define TIMERWHEEL_SLOT_MASK (TIMERWHEEL_SLOTS - 1)
+
+typedef struct {
+    uint64_t deadline;
+    uint32_t type;
+    uint64_t id;
+    uint64_t arg;
+} TimerEntry;
+
+// A hierarchical timing wheel, every level is 64 times coarser than the one
+// below it, so with one second ticks it covers about 190 days.
+// Timers can't be cancelled, owners check whether a timer still matters when
+// it comes due and schedule it again if it doesn't.
+// Not thread safe, every worker keeps its own.
+class TimerWheel {
+    private:
+        std::vector<TimerEntry> mSlots[TIMERWHEEL_LEVELS][TIMERWHEEL_SLOTS];
+        std::vector<TimerEntry> mCascade;
+        uint64_t mNow = 0;
+        size_t mCount = 0;
+
+        void Place(const TimerEntry& aEntry, bool aCurrentTick);
+
+    public:
+        void Begin(uint64_t aNow);
+        void Schedule(uint64_t aDeadline, uint32_t aType, uint64_t aId, uint64_t aArg);
+        void Advance(uint64_t aNow, std::vector<TimerEntry>& aDue);
+
+        uint64_t Now() { return mNow; }
+        size_t Count() { return mCount; }
+};
@@ -0,0 +1,170 @@
+#include <cstring>
+#include "transport.hpp"
+
+////////////
+// socket //
+////////////
+
+void SocketTransport::Begin() {
+    // set socket to non-blocking mode
+    SocketSetOptions(mSocket);
+}
+
+int SocketTransport::Recv(uint8_t* aData, size_t aSize, int* aError) {
+    // limit the buffer to the available amount
+    int64_t remaining = (int64_t)aSize;
+    SocketLimitBuffer(mSocket, &remaining);
+
+#ifdef OSX_BUILD
+    // OSX seems to return errno 0, size 0 on recv() when there is nothing to receive.
+    // This causes the socket to think the connection is closed...
+    // So instead, we'll just not call it if there is no data available.
+    // The side effect of this is that we will not detect connection drops very quickly.
+    if (remaining <= 0) {
+        *aError = SOCKET_EAGAIN;
+        return -1;
+    }
+#endif
+
+    SOCKET_RESET_ERROR();
+    int ret = recv(mSocket, (char*)aData, (size_t)remaining, MSG_DONTWAIT);
+    *aError = SOCKET_LAST_ERROR;
+    return ret;
+}
+
+int SocketTransport::Send(const uint8_t* aData, size_t aSize, int* aError) {
+    SOCKET_RESET_ERROR();
+    int sent = send(mSocket, (const char*)aData, aSize, MSG_NOSIGNAL);
+    *aError = SOCKET_LAST_ERROR;
+    return sent;
+}
+
+void SocketTransport::Close() {
+    SocketClose(mSocket);
+}
+
+uint64_t SocketTransport::Address() {
+    struct sockaddr_in addr = { 0 };
+    socklen_t len = sizeof(addr);
+    getpeername(mSocket, (struct sockaddr*)&addr, &len);
+    return (uint64_t)addr.sin_addr.s_addr;
+}
+
+//////////
+// pipe //
+//////////
+
+// buffers[side] holds the bytes waiting for that side to read them
+struct PipeTransportShared {
+    std::mutex mutex;
+    RingBuffer buffers[2];
+    bool closed = false;
+    std::function<void()> readable[2];
+    std::function<void()> writable[2];
+};
+
+void PipeTransport::Create(PipeTransport** aFirst, PipeTransport** aSecond) {
+    std::shared_ptr<PipeTransportShared> shared = std::make_shared<PipeTransportShared>();
+    *aFirst = new PipeTransport(shared, 0);
+    *aSecond = new PipeTransport(shared, 1);
+}
+
+PipeTransport::~PipeTransport() {
+    // the other side may outlive us, so it must stop calling back into our owner
+    std::lock_guard<std::mutex> guard(mShared->mutex);
+    mShared->closed = true;
+    mShared->readable[mSide] = nullptr;
+    mShared->writable[mSide] = nullptr;
+}
+
+int PipeTransport::Recv(uint8_t* aData, size_t aSize, int* aError) {
+    std::function<void()> writable;
+    size_t received = 0;
+    {
+        std::lock_guard<std::mutex> guard(mShared->mutex);
+        RingBuffer& buffer = mShared->buffers[mSide];
+        bool wasFull = buffer.Size() >= TRANSPORT_PIPE_CAPACITY;
+
+        while (received < aSize && buffer.Size() > 0) {
+            const uint8_t* data = nullptr;
+            size_t size = buffer.Peek(&data);
+            if (size > aSize - received) { size = aSize - received; }
+            memcpy(&aData[received], data, size);
+            buffer.Consume(size);
+            received += size;
+        }
+
+        if (received == 0) {
+            *aError = mShared->closed ? 0 : SOCKET_EAGAIN;
+            return mShared->closed ? 0 : -1;
+        }
+
+        if (wasFull && buffer.Size() < TRANSPORT_PIPE_CAPACITY) {
+            writable = mShared->writable[1 - mSide];
+        }
+    }
+
+    *aError = 0;
+    if (writable) { writable(); }
+    return (int)received;
+}
+
+int PipeTransport::Send(const uint8_t* aData, size_t aSize, int* aError) {
+    std::function<void()> readable;
+    size_t sent = 0;
+    {
+        std::lock_guard<std::mutex> guard(mShared->mutex);
+        if (mShared->closed) {
+            *aError = SOCKET_ECONNRESET;
+            return -1;
+        }
+
+        RingBuffer& buffer = mShared->buffers[1 - mSide];
+        size_t space = (buffer.Size() < TRANSPORT_PIPE_CAPACITY) ? TRANSPORT_PIPE_CAPACITY - buffer.Size() : 0;
+        if (space == 0) {
+            *aError = SOCKET_EAGAIN;
+            return -1;
+        }
+
+        // only the first bytes after running dry wake the reader, it drains everything
+        bool wasEmpty = (buffer.Size() == 0);
+        sent = (aSize < space) ? aSize : space;
+        if (!buffer.Write(aData, sent)) {
+            *aError = SOCKET_EAGAIN;
+            return -1;
+        }
+        if (wasEmpty) {
+            readable = mShared->readable[1 - mSide];
+        }
+    }
+
+    *aError = 0;
+    if (readable) { readable(); }
+    return (int)sent;
+}
+
+void PipeTransport::Close() {
+    std::function<void()> readable;
+    {
+        std::lock_guard<std::mutex> guard(mShared->mutex);
+        if (mShared->closed) { return; }
+        mShared->closed = true;
+        readable = mShared->readable[1 - mSide];
+    }
+
+    // let the other side read the end of the stream
+    if (readable) { readable(); }
+}
+
+void PipeTransport::Watch(std::function<void()> aReadable, std::function<void()> aWritable) {
+    bool pending = false;
+    {
+        std::lock_guard<std::mutex> guard(mShared->mutex);
+        mShared->readable[mSide] = aReadable;
+        mShared->writable[mSide] = aWritable;
+        pending = (mShared->buffers[mSide].Size() > 0 || mShared->closed);
+    }
+
+    // bytes may have arrived before anyone was watching
+    if (pending && aReadable) { aReadable(); }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include "socket.hpp"
+#include "ringbuffer.hpp"
+
+// a pipe end stops taking bytes once this much is waiting, like a socket buffer would
+#define TRANSPORT_PIPE_CAPACITY (256 * 1024)
+
+// Moves a connection's bytes.
+// Recv() and Send() follow recv()/send(): the amount moved, 0 from Recv() once
+// the other side closed, or -1 with the socket error code in aError.
+// SOCKET_EAGAIN means nothing could be moved right now.
+class Transport {
+    public:
+        virtual ~Transport() {}
+
+        virtual void Begin() {}
+        virtual int Recv(uint8_t* aData, size_t aSize, int* aError) = 0;
+        virtual int Send(const uint8_t* aData, size_t aSize, int* aError) = 0;
+        virtual void Close() = 0;
+
+        // the socket a reactor can wait on, or -1 when the transport calls back instead
+        virtual int Socket() { return -1; }
+        virtual uint64_t Address() { return 0; }
+
+        // called once bytes arrive after the transport ran dry, and once a full transport has room again
+        virtual void Watch(std::function<void()> aReadable, std::function<void()> aWritable) {}
+};
+
+// a connected, non-blocking socket
+class SocketTransport : public Transport {
+    private:
+        int mSocket = -1;
+
+    public:
+        SocketTransport(int aSocket) : mSocket(aSocket) {}
+
+        void Begin() override;
+        int Recv(uint8_t* aData, size_t aSize, int* aError) override;
+        int Send(const uint8_t* aData, size_t aSize, int* aError) override;
+        void Close() override;
+        int Socket() override { return mSocket; }
+        uint64_t Address() override;
+};
+
+typedef struct PipeTransportShared PipeTransportShared;
+
+// One end of an in-memory pipe, so a server and its clients can share a
+// process without the kernel's networking in between.
+// Both ends may be used from different threads.
+class PipeTransport : public Transport {
+    private:
+        std::shared_ptr<PipeTransportShared> mShared;
+        int mSide = 0;
+
+        PipeTransport(std::shared_ptr<PipeTransportShared> aShared, int aSide) : mShared(aShared), mSide(aSide) {}
+
+    public:
+        ~PipeTransport();
+
+        static void Create(PipeTransport** aFirst, PipeTransport** aSecond);
+
+        int Recv(uint8_t* aData, size_t aSize, int* aError) override;
+        int Send(const uint8_t* aData, size_t aSize, int* aError) override;
+        void Close() override;
+        void Watch(std::function<void()> aReadable, std::function<void()> aWritable) override;
+};
@@ -8,6 +8,7 @@
 #include <fstream>
 #include <filesystem>
 #include "socket.hpp"
+#include "coarseclock.hpp"
 
 #if defined(__APPLE__)
 // for _NSGetExecutablePath
@@ -24,33 +25,10 @@ in_addr_t GetAddrFromDomain(const std::string& domain) {
     return addr_list[0]->s_addr;
 }
 
-static void _clock_gettime(struct timespec* clock_time) {
-#if !defined _POSIX_MONOTONIC_CLOCK || _POSIX_MONOTONIC_CLOCK < 0
-    clock_gettime(CLOCK_REALTIME, clock_time);
-#elif _POSIX_MONOTONIC_CLOCK > 0
-    clock_gettime(CLOCK_MONOTONIC, clock_time);
-#else
-    if (clock_gettime(CLOCK_MONOTONIC, clock_time)) {
-        clock_gettime(CLOCK_REALTIME, clock_time);
-    }
-#endif
-}
-
 static uint64_t clock_elapsed_ns(void) {
-    static bool sClockInitialized = false;
-    static uint64_t clock_start_ns;
-    if (!sClockInitialized) {
-        struct timespec clock_start = { 0 };
-        _clock_gettime(&clock_start);
-        clock_start_ns = ((uint64_t)clock_start.tv_sec) * 1000000000 + ((uint64_t)clock_start.tv_nsec);
-        sClockInitialized = true;
-    }
-
-    struct timespec clock_current = { 0 };
-    _clock_gettime(&clock_current);
-
-    uint64_t clock_current_ns = ((uint64_t)clock_current.tv_sec) * 1000000000 + ((uint64_t)clock_current.tv_nsec);
-    return (clock_current_ns - clock_start_ns);
+    // coarse, the client refreshes it every update
+    static uint64_t clock_start_ns = CoarseClockMonotonicNs();
+    return (CoarseClockMonotonicNs() - clock_start_ns);
 }
 
 float clock_elapsed(void) {
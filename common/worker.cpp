@@ -0,0 +1,265 @@
+#include "worker.hpp"
+#include "server.hpp"
+#include "connection.hpp"
+#include "libcoopnet.h"
+#include "logging.hpp"
+#include "coarseclock.hpp"
+
+static thread_local Worker* sCurrentWorker = nullptr;
+
+static void sWorkerStart(Worker* worker) { worker->Update(); }
+
+bool Worker::Begin(uint32_t aIndex) {
+    mIndex = aIndex;
+
+    if (!mReactor.Begin()) {
+        LOG_ERROR("[worker %u] Failed to create reactor!", mIndex);
+        return false;
+    }
+
+    // the first worker also looks after the server-wide reputation
+    uint64_t now = CoarseClockNow();
+    mTimers.Begin(now);
+    if (mIndex == 0) {
+        TimerSchedule(now + WORKER_REPUTATION_PURGE_SECS, WORKER_TIMER_REPUTATION, 0, 0);
+    }
+
+    mThread = std::thread(sWorkerStart, this);
+    mThread.detach();
+    return true;
+}
+
+Worker* Worker::Current() {
+    return sCurrentWorker;
+}
+
+void Worker::Adopt(Connection* aConnection) {
+    aConnection->mWorker = this;
+    {
+        std::lock_guard<std::mutex> guard(mQueueMutex);
+        mAdoptQueue.push_back(aConnection);
+    }
+    mReactor.Wake();
+}
+
+void Worker::Post(uint64_t aConnectionId, WorkerTask aTask) {
+    {
+        std::lock_guard<std::mutex> guard(mQueueMutex);
+        mMessageQueue.push_back({ aConnectionId, std::move(aTask), nullptr, false });
+    }
+    mReactor.Wake();
+}
+
+void Worker::PostBytes(uint64_t aConnectionId, const std::shared_ptr<std::string>& aBytes, bool aBulk) {
+    {
+        std::lock_guard<std::mutex> guard(mQueueMutex);
+        mMessageQueue.push_back({ aConnectionId, nullptr, aBytes, aBulk });
+    }
+    mReactor.Wake();
+}
+
+void Worker::Release(uint64_t aConnectionId) {
+    std::lock_guard<std::mutex> guard(mQueueMutex);
+    mClosedQueue.push_back(aConnectionId);
+}
+
+void Worker::TimerSchedule(uint64_t aDeadline, enum WorkerTimer aType, uint64_t aId, uint64_t aArg) {
+    mTimers.Schedule(aDeadline, aType, aId, aArg);
+}
+
+Connection* Worker::ConnectionGet(uint64_t aConnectionId) {
+    return mConnections.Get(aConnectionId);
+}
+
+void Worker::DrainQueue() {
+    std::vector<Connection*> adopt;
+    std::vector<WorkerMessage> messages;
+    {
+        std::lock_guard<std::mutex> guard(mQueueMutex);
+        adopt.swap(mAdoptQueue);
+        messages.swap(mMessageQueue);
+    }
+
+    // take ownership of newly accepted connections
+    if (!adopt.empty()) {
+        std::lock_guard<std::recursive_mutex> guard(gServer->mLobbiesMutex);
+        for (auto& connection : adopt) {
+            mConnections.Add(connection);
+
+            // wake up whenever this socket has data,
+            // transports without a socket call back and queue the work instead
+            int socket = connection->mTransport->Socket();
+            if (connection->mActive && socket >= 0 && mReactor.Add(socket, connection->mHandle, REACTOR_READ)) {
+                connection->mReactor = &mReactor;
+            } else if (connection->mActive && socket < 0) {
+                uint64_t id = connection->mId;
+                connection->mTransport->Watch(
+                    [this, id]() { Post(id, [](Connection& aConnection) { aConnection.Receive(); }); },
+                    [this, id]() { Post(id, [](Connection& aConnection) { aConnection.Flush(); }); });
+            }
+
+            // the accept thread may have left some bytes behind
+            connection->Flush();
+
+            // check on it again once it's been quiet for too long
+            TimerSchedule(connection->LastSendTime() + CONNECTION_KEEP_ALIVE_SECS + 1, WORKER_TIMER_KEEP_ALIVE, connection->mHandle, 0);
+            TimerSchedule(connection->LastReceiveTime() + CONNECTION_DEAD_SECS + 1, WORKER_TIMER_DEAD, connection->mHandle, 0);
+            if (connection->Evicted()) {
+                // evicted before it had a worker, so nobody queued its disconnect
+                connection->Disconnect(false);
+            } else if (!connection->mActive) {
+                Release(connection->mId);
+            }
+            LOG_INFO("[%" PRIu64 "] Connection added to worker %u, count: %" PRIu64 "", connection->mId, mIndex, (uint64_t)mConnections.Size());
+        }
+    }
+
+    // run the tasks other workers handed over
+    for (auto& it : messages) {
+        Connection* connection = ConnectionGet(it.connectionId);
+        if (!connection || !connection->mActive) {
+            LOG_ERROR("Could not find user: %" PRIu64 "", it.connectionId);
+            continue;
+        }
+        if (it.bytes) {
+            connection->Send((const uint8_t*)it.bytes->data(), (int64_t)it.bytes->size(), it.bulk);
+        } else {
+            it.task(*connection);
+        }
+    }
+}
+
+void Worker::Update() {
+    sCurrentWorker = this;
+    ReactorEvent events[REACTOR_MAX_EVENTS];
+    uint64_t nextHousekeepingNs = CoarseClockMonotonicNs();
+
+    while (true) {
+        // sleep until a socket is readable, a task arrives, or the next housekeeping is due
+        uint64_t nowNs = CoarseClockMonotonicNs();
+        int timeoutMs = 0;
+        if (nextHousekeepingNs > nowNs) {
+            timeoutMs = (int)((nextHousekeepingNs - nowNs) / 1000000) + 1;
+        }
+        int count = mReactor.Wait(events, REACTOR_MAX_EVENTS, timeoutMs);
+
+        // the only clock read this iteration, the packets below use this time
+        CoarseClockUpdate();
+
+        DrainQueue();
+
+        // service the sockets that woke us up
+        for (int i = 0; i < count; i++) {
+            // events name connections by handle, a stale one is simply dropped
+            uint32_t slot = 0;
+            if (!mConnections.Resolve(events[i].id, &slot) || !mConnections.Active(slot)) { continue; }
+            Connection* connection = mConnections.At(slot);
+            if (events[i].events & REACTOR_WRITE) {
+                connection->Flush();
+            }
+            if (events[i].events & REACTOR_READ) {
+                connection->Receive();
+            }
+        }
+
+        // check on idle connections at a much slower rate
+        nowNs = CoarseClockMonotonicNs();
+        if (nowNs >= nextHousekeepingNs) {
+            nextHousekeepingNs = nowNs + SERVER_HOUSEKEEPING_MS * 1000000ULL;
+            Housekeeping();
+        }
+    }
+}
+
+void Worker::TimerFire(const TimerEntry& aTimer, uint64_t aNow) {
+    if (aTimer.type == WORKER_TIMER_REPUTATION) {
+        gServer->ReputationUpdate();
+        TimerSchedule(aNow + WORKER_REPUTATION_PURGE_SECS, WORKER_TIMER_REPUTATION, 0, 0);
+        return;
+    }
+
+    // connection timers hold a handle, the times are in the table and
+    // the connection itself is only needed to act on it
+    uint32_t slot = 0;
+    if (!mConnections.Resolve(aTimer.id, &slot) || !mConnections.Active(slot)) { return; }
+
+    switch (aTimer.type) {
+        case WORKER_TIMER_KEEP_ALIVE:
+            // send a packet with no important informations every 3 minutes,
+            // just to keep the connection alive
+            if ((mConnections.LastSendTime(slot) + CONNECTION_KEEP_ALIVE_SECS) < aNow) {
+                MPacketKeepAlive({ 0 }).Send(*mConnections.At(slot));
+            }
+            TimerSchedule(mConnections.LastSendTime(slot) + CONNECTION_KEEP_ALIVE_SECS + 1, WORKER_TIMER_KEEP_ALIVE, aTimer.id, 0);
+            break;
+
+        case WORKER_TIMER_DEAD:
+            if ((aNow - mConnections.LastReceiveTime(slot)) > CONNECTION_DEAD_SECS) {
+                LOG_INFO("[%" PRIu64 "] Connection timeout", mConnections.Id(slot));
+                mConnections.At(slot)->Disconnect(true);
+                break;
+            }
+            TimerSchedule(mConnections.LastReceiveTime(slot) + CONNECTION_DEAD_SECS + 1, WORKER_TIMER_DEAD, aTimer.id, 0);
+            break;
+
+        case WORKER_TIMER_PEER:
+            mConnections.At(slot)->PeerTimeout(aTimer.arg, aNow);
+            break;
+    }
+}
+
+void Worker::Housekeeping() {
+    // connections are only removed while holding the lobby mutex
+    std::lock_guard<std::recursive_mutex> guard(gServer->mLobbiesMutex);
+    uint64_t now = CoarseClockNow();
+
+    // only the timers that came due, not every connection
+    mTimers.Advance(now, mTimersDue);
+    for (auto& it : mTimersDue) {
+        TimerFire(it, now);
+    }
+    mTimersDue.clear();
+
+    // a ban change is the only reason to look at every connection,
+    // the check may block so it runs on the admission threads instead of under this lock
+    uint64_t banGeneration = gServer->BanGeneration();
+    if (banGeneration != mBanGeneration && gCoopNetCallbacks.ConnectionIsAllowed) {
+        mBanGeneration = banGeneration;
+        for (uint32_t slot = 0; slot < mConnections.Size(); slot++) {
+            if (!mConnections.Active(slot)) { continue; }
+            gServer->ConnectionRecheck(mConnections.At(slot));
+        }
+    }
+
+    // free the connections that closed since last time
+    std::vector<uint64_t> closed;
+    {
+        std::lock_guard<std::mutex> queueGuard(mQueueMutex);
+        closed.swap(mClosedQueue);
+    }
+    for (auto& id : closed) {
+        uint32_t slot = 0;
+        if (!mConnections.Find(id, &slot)) { continue; }
+        Connection* connection = mConnections.At(slot);
+
+        // never free a connection that's still in use
+        if (connection->mActive) {
+            continue;
+        }
+
+        // a ban check may still be reading it, try again next time
+        if (connection->mRechecks > 0) {
+            Release(id);
+            continue;
+        }
+
+        LOG_INFO("[%" PRIu64 "] Connection removed from worker %u, count: %" PRIu64 "", connection->mId, mIndex, (uint64_t)mConnections.Size());
+        mConnections.Remove(slot);
+        delete connection;
+    }
+
+    // the first worker also looks after the server-wide state
+    if (mIndex == 0) {
+        gServer->Housekeeping();
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <map>
+#include <functional>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include "reactor.hpp"
+#include "timerwheel.hpp"
+#include "connectiontable.hpp"
+
+class Connection;
+
+// the connection timers carry the connection's handle as their id
+enum WorkerTimer {
+    WORKER_TIMER_KEEP_ALIVE,
+    WORKER_TIMER_DEAD,
+    WORKER_TIMER_PEER,
+    WORKER_TIMER_REPUTATION,
+};
+
+#define WORKER_REPUTATION_PURGE_SECS (60 * 60)
+
+typedef std::function<void(Connection& aConnection)> WorkerTask;
+
+// either a task to run, or encoded bytes to send that may be shared between workers
+typedef struct {
+    uint64_t connectionId;
+    WorkerTask task;
+    std::shared_ptr<std::string> bytes;
+    bool bulk;
+} WorkerMessage;
+
+// A server thread that owns a shard of the connections.
+// Only the owning worker reads from or writes to a connection's socket,
+// everyone else has to Post() a task to it.
+// The connection table is only modified while holding the server's lobby
+// mutex, so other workers may look connections up while holding it too.
+class Worker {
+    private:
+        std::thread mThread;
+        Reactor mReactor;
+        ConnectionTable mConnections;
+        std::mutex mQueueMutex;
+        std::vector<Connection*> mAdoptQueue;
+        std::vector<WorkerMessage> mMessageQueue;
+        std::vector<uint64_t> mClosedQueue;
+        uint64_t mBanGeneration = 0;
+        TimerWheel mTimers;
+        std::vector<TimerEntry> mTimersDue;
+
+        void DrainQueue();
+        void Housekeeping();
+        void TimerFire(const TimerEntry& aTimer, uint64_t aNow);
+
+    public:
+        uint32_t mIndex = 0;
+
+        bool Begin(uint32_t aIndex);
+        void Update();
+
+        void Adopt(Connection* aConnection);
+        void Post(uint64_t aConnectionId, WorkerTask aTask);
+        void PostBytes(uint64_t aConnectionId, const std::shared_ptr<std::string>& aBytes, bool aBulk);
+        void Release(uint64_t aConnectionId);
+        Connection* ConnectionGet(uint64_t aConnectionId);
+
+        void TimerSchedule(uint64_t aDeadline, enum WorkerTimer aType, uint64_t aId, uint64_t aArg);
+
+        static Worker* Current();
+};
@@ -0,0 +1,640 @@
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <queue>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <cinttypes>
+#include "mpacket.hpp"
+#include "reactor.hpp"
+#include "socket.hpp"
+#include "utils.hpp"
+
+#define HOST "localhost"
+#define PORT 34197
+#define EXIT_FAILURE 1
+
+#define DEFAULT_CLIENTS 1000
+#define DEFAULT_THREADS 4
+#define DEFAULT_SECONDS 30
+#define DEFAULT_RATE 1.0
+#define DEFAULT_LOBBY_SIZE 8
+#define DEFAULT_MIX "create:1,join:4,list:10,sdp:20,candidate:40"
+
+#define LOADGEN_GAME "loadgen"
+#define LOADGEN_TIMEOUT_NS (5ULL * 1000 * 1000 * 1000)
+#define LOADGEN_RETRY_NS (50ULL * 1000 * 1000)
+#define LOADGEN_SDP_SIZE 600
+#define LOADGEN_CANDIDATE_SIZE 80
+#define LOADGEN_STAMP_DIGITS 20
+
+enum LoadOp {
+    LOAD_OP_CREATE,
+    LOAD_OP_JOIN,
+    LOAD_OP_LIST,
+    LOAD_OP_SDP,
+    LOAD_OP_CANDIDATE,
+    LOAD_OP_MAX,
+};
+
+static const char* sOpNames[LOAD_OP_MAX] = { "create", "join", "list", "sdp", "candidate" };
+static const char* sOpPackets[LOAD_OP_MAX] = { "lobby_create", "lobby_join", "lobby_list_get", "peer_sdp", "peer_candidate" };
+
+// every client belongs to a group, the first client of the group hosts the
+// lobby the rest of the group joins and exchanges sdp/candidates in
+typedef struct {
+    int socket;
+    uint32_t index;
+    uint32_t group;
+    bool host;
+    uint64_t userId;
+    uint64_t lobbyId;
+    int pending;
+    uint64_t pendingSince;
+    std::vector<uint8_t> inbound;
+    std::string outbound;
+} LoadClient;
+
+typedef struct {
+    std::vector<uint64_t> latencies[LOAD_OP_MAX];
+    uint64_t sent[LOAD_OP_MAX];
+    uint64_t errors[LOAD_OP_MAX];
+    uint64_t timeouts[LOAD_OP_MAX];
+    uint64_t packetsSent;
+    uint64_t packetsReceived;
+    uint64_t bytesSent;
+    uint64_t bytesReceived;
+    uint64_t disconnects;
+} LoadStats;
+
+typedef struct {
+    std::string host;
+    in_addr_t address;
+    uint16_t port;
+    uint32_t clients;
+    uint32_t threads;
+    uint32_t seconds;
+    double rate;
+    uint32_t lobbySize;
+    uint32_t mix[LOAD_OP_MAX];
+} LoadSettings;
+
+static LoadSettings sSettings;
+static std::unique_ptr<std::atomic<uint64_t>[]> sGroupLobbies;
+static std::unique_ptr<std::atomic<uint64_t>[]> sUserIds;
+static std::atomic<uint32_t> sThreadsReady(0);
+static std::atomic<uint64_t> sStartNs(0);
+
+static uint64_t sNowNs(void) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool sParseMix(const char* aMix, uint32_t* aWeights) {
+    memset(aWeights, 0, sizeof(uint32_t) * LOAD_OP_MAX);
+    std::string mix = aMix;
+    size_t start = 0;
+    while (start < mix.size()) {
+        size_t end = mix.find(',', start);
+        if (end == std::string::npos) { end = mix.size(); }
+        std::string entry = mix.substr(start, end - start);
+        size_t colon = entry.find(':');
+        if (colon == std::string::npos) { return false; }
+        std::string name = entry.substr(0, colon);
+        int op = 0;
+        while (op < LOAD_OP_MAX && name != sOpNames[op]) { op++; }
+        if (op == LOAD_OP_MAX) { return false; }
+        aWeights[op] = (uint32_t)atoi(entry.c_str() + colon + 1);
+        start = end + 1;
+    }
+    return true;
+}
+
+class LoadThread {
+    private:
+        uint32_t mFirst = 0;
+        std::vector<LoadClient> mClients;
+        Reactor mReactor;
+        std::mt19937 mRng;
+        typedef std::pair<uint64_t, uint32_t> Scheduled;
+        std::priority_queue<Scheduled, std::vector<Scheduled>, std::greater<Scheduled>> mSchedule;
+
+        bool Connect(LoadClient& aClient);
+        void Disconnect(LoadClient& aClient);
+        void Send(LoadClient& aClient, MPacket& aPacket);
+        void Flush(LoadClient& aClient);
+        void Receive(LoadClient& aClient, uint64_t aNow);
+        void Process(LoadClient& aClient, uint8_t* aData, uint64_t aNow);
+        void Complete(LoadClient& aClient, int aOp, uint64_t aNow);
+        void Begin(LoadClient& aClient, int aOp, uint64_t aNow);
+        void Step(LoadClient& aClient, uint64_t aNow);
+        uint64_t NextDelay(void);
+        int PickOp(LoadClient& aClient);
+        uint64_t PickPeer(LoadClient& aClient);
+        bool Measuring(uint64_t aNow);
+
+    public:
+        LoadStats mStats = {};
+        bool Setup(uint32_t aFirst, uint32_t aCount);
+        void Run(void);
+};
+
+bool LoadThread::Setup(uint32_t aFirst, uint32_t aCount) {
+    mFirst = aFirst;
+    mRng.seed(aFirst + 1);
+    if (!mReactor.Begin()) { return false; }
+
+    mClients.resize(aCount);
+    for (uint32_t i = 0; i < aCount; i++) {
+        LoadClient& client = mClients[i];
+        client.socket = -1;
+        client.index = aFirst + i;
+        client.group = client.index / sSettings.lobbySize;
+        client.host = (client.index % sSettings.lobbySize) == 0;
+        client.userId = 0;
+        client.lobbyId = 0;
+        client.pending = LOAD_OP_MAX;
+        client.pendingSince = 0;
+        if (!Connect(client)) { return false; }
+        mReactor.Add(client.socket, i + 1, REACTOR_READ | REACTOR_WRITE);
+    }
+    return true;
+}
+
+bool LoadThread::Connect(LoadClient& aClient) {
+    aClient.socket = SocketInitialize(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (aClient.socket < 0) {
+        printf("Socket failed for client %u\n", aClient.index);
+        return false;
+    }
+
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = sSettings.address;
+    address.sin_port = htons(sSettings.port);
+
+    // connect while still blocking, the swarm is set up before the clock starts
+    if (connect(aClient.socket, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        printf("Connect failed for client %u: %d\n", aClient.index, SOCKET_LAST_ERROR);
+        SocketClose(aClient.socket);
+        aClient.socket = -1;
+        return false;
+    }
+
+    SocketSetOptions(aClient.socket);
+    return true;
+}
+
+void LoadThread::Disconnect(LoadClient& aClient) {
+    if (aClient.socket < 0) { return; }
+    mReactor.Remove(aClient.socket);
+    SocketClose(aClient.socket);
+    aClient.socket = -1;
+    mStats.disconnects++;
+}
+
+bool LoadThread::Measuring(uint64_t aNow) {
+    return aNow >= sStartNs.load();
+}
+
+void LoadThread::Send(LoadClient& aClient, MPacket& aPacket) {
+    static thread_local uint8_t sData[MPACKET_MAX_SIZE];
+    int64_t size = aPacket.Serialize(sData, MPACKET_MAX_SIZE);
+    if (size <= 0 || aClient.socket < 0) { return; }
+    aClient.outbound.append((const char*)sData, (size_t)size);
+    mStats.packetsSent++;
+    mStats.bytesSent += (uint64_t)size;
+    Flush(aClient);
+}
+
+void LoadThread::Flush(LoadClient& aClient) {
+    size_t offset = 0;
+    while (offset < aClient.outbound.size() && aClient.socket >= 0) {
+        SOCKET_RESET_ERROR();
+        int rc = send(aClient.socket, aClient.outbound.data() + offset, aClient.outbound.size() - offset, MSG_NOSIGNAL);
+        if (rc > 0) {
+            offset += (size_t)rc;
+            continue;
+        }
+        int error = SOCKET_LAST_ERROR;
+        if (rc < 0 && (error == SOCKET_EAGAIN || error == SOCKET_EWOULDBLOCK)) { break; }
+        Disconnect(aClient);
+    }
+    aClient.outbound.erase(0, offset);
+}
+
+void LoadThread::Receive(LoadClient& aClient, uint64_t aNow) {
+    uint8_t data[MPACKET_MAX_SIZE];
+    while (aClient.socket >= 0) {
+        SOCKET_RESET_ERROR();
+        int rc = recv(aClient.socket, (char*)data, sizeof(data), MSG_DONTWAIT);
+        if (rc == 0) {
+            Disconnect(aClient);
+            break;
+        }
+        if (rc < 0) {
+            int error = SOCKET_LAST_ERROR;
+            if (error != SOCKET_EAGAIN && error != SOCKET_EWOULDBLOCK) { Disconnect(aClient); }
+            break;
+        }
+        mStats.bytesReceived += (uint64_t)rc;
+        aClient.inbound.insert(aClient.inbound.end(), data, data + rc);
+    }
+
+    // only the header and the fixed data are looked at, the strings are skipped
+    size_t offset = 0;
+    while (aClient.inbound.size() - offset >= sizeof(MPacketHeader)) {
+        MPacketHeader header;
+        memcpy(&header, &aClient.inbound[offset], sizeof(MPacketHeader));
+        size_t totalSize = sizeof(MPacketHeader) + header.dataSize + header.stringSize;
+        if (aClient.inbound.size() - offset < totalSize) { break; }
+        mStats.packetsReceived++;
+        Process(aClient, &aClient.inbound[offset], aNow);
+        offset += totalSize;
+    }
+    aClient.inbound.erase(aClient.inbound.begin(), aClient.inbound.begin() + offset);
+}
+
+void LoadThread::Process(LoadClient& aClient, uint8_t* aData, uint64_t aNow) {
+    MPacketHeader header;
+    memcpy(&header, aData, sizeof(MPacketHeader));
+    uint8_t* data = aData + sizeof(MPacketHeader);
+
+    switch (header.packetType) {
+        case MPACKET_JOINED: {
+            MPacketJoinedData joined;
+            memcpy(&joined, data, sizeof(joined));
+            if (joined.version != MPACKET_PROTOCOL_VERSION) {
+                printf("Server speaks protocol version %u, expected %u\n", joined.version, MPACKET_PROTOCOL_VERSION);
+                exit(EXIT_FAILURE);
+            }
+            aClient.userId = joined.userId;
+            sUserIds[aClient.index] = joined.userId;
+            break;
+        }
+        case MPACKET_LOBBY_CREATED: {
+            MPacketLobbyCreatedData created;
+            memcpy(&created, data, sizeof(created));
+            aClient.lobbyId = created.lobbyId;
+            if (aClient.pending != LOAD_OP_CREATE) { break; }
+            Complete(aClient, LOAD_OP_CREATE, aNow);
+            if (aClient.host) {
+                sGroupLobbies[aClient.group] = created.lobbyId;
+            } else {
+                // a guest only created a lobby to measure it, go back to the group
+                Begin(aClient, LOAD_OP_JOIN, aNow);
+            }
+            break;
+        }
+        case MPACKET_LOBBY_JOINED: {
+            MPacketLobbyJoinedData joined;
+            memcpy(&joined, data, sizeof(joined));
+            if (joined.userId != aClient.userId) { break; }
+            aClient.lobbyId = joined.lobbyId;
+            if (aClient.pending == LOAD_OP_JOIN) { Complete(aClient, LOAD_OP_JOIN, aNow); }
+            break;
+        }
+        case MPACKET_LOBBY_LEFT: {
+            MPacketLobbyLeftData left;
+            memcpy(&left, data, sizeof(left));
+            if (left.userId == aClient.userId && left.lobbyId == aClient.lobbyId) { aClient.lobbyId = 0; }
+            break;
+        }
+        case MPACKET_LOBBY_LIST_FINISH:
+            if (aClient.pending == LOAD_OP_LIST) { Complete(aClient, LOAD_OP_LIST, aNow); }
+            break;
+        case MPACKET_PEER_SDP:
+        case MPACKET_PEER_CANDIDATE: {
+            // the sender stamped the relayed string, so the latency is measured here
+            int op = (header.packetType == MPACKET_PEER_SDP) ? LOAD_OP_SDP : LOAD_OP_CANDIDATE;
+            uint8_t* string = data + header.dataSize;
+            uint16_t length = 0;
+            memcpy(&length, string, sizeof(uint16_t));
+            if (length < LOADGEN_STAMP_DIGITS) { break; }
+            char stamp[LOADGEN_STAMP_DIGITS + 1] = { 0 };
+            memcpy(stamp, string + sizeof(uint16_t), LOADGEN_STAMP_DIGITS);
+            uint64_t sentNs = strtoull(stamp, nullptr, 10);
+            if (Measuring(sentNs) && aNow >= sentNs) { mStats.latencies[op].push_back(aNow - sentNs); }
+            break;
+        }
+        case MPACKET_ERROR:
+            if (aClient.pending == LOAD_OP_MAX) { break; }
+            if (Measuring(aClient.pendingSince)) { mStats.errors[aClient.pending]++; }
+            aClient.pending = LOAD_OP_MAX;
+            break;
+        default:
+            break;
+    }
+}
+
+void LoadThread::Complete(LoadClient& aClient, int aOp, uint64_t aNow) {
+    if (Measuring(aClient.pendingSince)) {
+        mStats.latencies[aOp].push_back(aNow - aClient.pendingSince);
+    }
+    aClient.pending = LOAD_OP_MAX;
+}
+
+void LoadThread::Begin(LoadClient& aClient, int aOp, uint64_t aNow) {
+    if (Measuring(aNow)) { mStats.sent[aOp]++; }
+
+    switch (aOp) {
+        case LOAD_OP_CREATE: {
+            aClient.pending = aOp;
+            aClient.pendingSince = aNow;
+            MPacketLobbyCreate packet({
+                .maxConnections = (uint16_t)sSettings.lobbySize
+            }, { LOADGEN_GAME, "v1", "Load Generator", "Load", "", "a synthetic lobby" });
+            Send(aClient, packet);
+            break;
+        }
+        case LOAD_OP_JOIN: {
+            uint64_t lobbyId = sGroupLobbies[aClient.group];
+            // joining the lobby you're already in is not answered, so leave it first
+            if (aClient.lobbyId == lobbyId) {
+                MPacketLobbyLeave leave({ .lobbyId = lobbyId });
+                Send(aClient, leave);
+            }
+            aClient.pending = aOp;
+            aClient.pendingSince = aNow;
+            MPacketLobbyJoin packet({ .lobbyId = lobbyId }, { "" });
+            Send(aClient, packet);
+            break;
+        }
+        case LOAD_OP_LIST: {
+            aClient.pending = aOp;
+            aClient.pendingSince = aNow;
+            MPacketLobbyListGet packet({}, { LOADGEN_GAME, "" });
+            Send(aClient, packet);
+            break;
+        }
+        case LOAD_OP_SDP:
+        case LOAD_OP_CANDIDATE: {
+            uint64_t peerId = PickPeer(aClient);
+            if (peerId == 0) { break; }
+            char stamp[LOADGEN_STAMP_DIGITS + 1];
+            snprintf(stamp, sizeof(stamp), "%0*" PRIu64, LOADGEN_STAMP_DIGITS, aNow);
+            std::string payload = stamp;
+            payload.resize((aOp == LOAD_OP_SDP) ? LOADGEN_SDP_SIZE : LOADGEN_CANDIDATE_SIZE, 'x');
+            if (aOp == LOAD_OP_SDP) {
+                MPacketPeerSdp packet({ .lobbyId = aClient.lobbyId, .userId = peerId }, { payload });
+                Send(aClient, packet);
+            } else {
+                MPacketPeerCandidate packet({ .lobbyId = aClient.lobbyId, .userId = peerId }, { payload });
+                Send(aClient, packet);
+            }
+            break;
+        }
+    }
+}
+
+int LoadThread::PickOp(LoadClient& aClient) {
+    // a host leaving would tear down its group, so it never creates or joins again
+    uint32_t total = 0;
+    for (int i = 0; i < LOAD_OP_MAX; i++) {
+        if (aClient.host && (i == LOAD_OP_CREATE || i == LOAD_OP_JOIN)) { continue; }
+        total += sSettings.mix[i];
+    }
+    if (total == 0) { return LOAD_OP_MAX; }
+
+    uint32_t pick = mRng() % total;
+    for (int i = 0; i < LOAD_OP_MAX; i++) {
+        if (aClient.host && (i == LOAD_OP_CREATE || i == LOAD_OP_JOIN)) { continue; }
+        if (pick < sSettings.mix[i]) { return i; }
+        pick -= sSettings.mix[i];
+    }
+    return LOAD_OP_MAX;
+}
+
+uint64_t LoadThread::PickPeer(LoadClient& aClient) {
+    uint32_t first = aClient.group * sSettings.lobbySize;
+    uint32_t count = std::min(sSettings.lobbySize, sSettings.clients - first);
+    if (count < 2) { return 0; }
+    uint32_t other = first + (aClient.index - first + 1 + mRng() % (count - 1)) % count;
+    return sUserIds[other];
+}
+
+uint64_t LoadThread::NextDelay(void) {
+    std::exponential_distribution<double> distribution(sSettings.rate);
+    return (uint64_t)(distribution(mRng) * 1000000000.0);
+}
+
+void LoadThread::Step(LoadClient& aClient, uint64_t aNow) {
+    if (aClient.socket < 0) { return; }
+    uint32_t index = aClient.index - mFirst;
+
+    // still waiting on something
+    if (aClient.userId == 0 || aClient.pending != LOAD_OP_MAX) {
+        if (aClient.pending != LOAD_OP_MAX && aNow - aClient.pendingSince > LOADGEN_TIMEOUT_NS) {
+            if (Measuring(aClient.pendingSince)) { mStats.timeouts[aClient.pending]++; }
+            aClient.pending = LOAD_OP_MAX;
+        }
+        mSchedule.push({ aNow + LOADGEN_RETRY_NS, index });
+        return;
+    }
+
+    // get every client into its group's lobby first
+    uint64_t groupLobbyId = sGroupLobbies[aClient.group];
+    if (aClient.host && groupLobbyId == 0) {
+        Begin(aClient, LOAD_OP_CREATE, aNow);
+    } else if (!aClient.host && groupLobbyId == 0) {
+        mSchedule.push({ aNow + LOADGEN_RETRY_NS, index });
+        return;
+    } else if (aClient.lobbyId != groupLobbyId) {
+        Begin(aClient, LOAD_OP_JOIN, aNow);
+    } else {
+        int op = PickOp(aClient);
+        if (op != LOAD_OP_MAX) { Begin(aClient, op, aNow); }
+    }
+
+    mSchedule.push({ aNow + NextDelay(), index });
+}
+
+void LoadThread::Run(void) {
+    uint64_t now = sNowNs();
+    for (uint32_t i = 0; i < mClients.size(); i++) {
+        mSchedule.push({ now + NextDelay(), i });
+    }
+
+    uint64_t endNs = sStartNs.load() + (uint64_t)sSettings.seconds * 1000000000ULL;
+    ReactorEvent events[REACTOR_MAX_EVENTS];
+    while (true) {
+        now = sNowNs();
+        if (now >= endNs) { break; }
+
+        int timeoutMs = (int)((endNs - now) / 1000000);
+        if (!mSchedule.empty()) {
+            uint64_t next = mSchedule.top().first;
+            timeoutMs = (next > now) ? (int)((next - now) / 1000000) : 0;
+        }
+
+        int count = mReactor.Wait(events, REACTOR_MAX_EVENTS, timeoutMs);
+        now = sNowNs();
+        for (int i = 0; i < count; i++) {
+            if (events[i].id == REACTOR_WAKE_ID) { continue; }
+            LoadClient& client = mClients[events[i].id - 1];
+            if (events[i].events & REACTOR_WRITE) { Flush(client); }
+            if (events[i].events & (REACTOR_READ | REACTOR_CLOSE)) { Receive(client, now); }
+        }
+
+        while (!mSchedule.empty() && mSchedule.top().first <= now) {
+            uint32_t index = mSchedule.top().second;
+            mSchedule.pop();
+            Step(mClients[index], now);
+        }
+    }
+
+    for (auto& it : mClients) {
+        if (it.socket < 0) { continue; }
+        mReactor.Remove(it.socket);
+        SocketClose(it.socket);
+        it.socket = -1;
+    }
+}
+
+static double sPercentileMs(std::vector<uint64_t>& aSorted, double aPercentile) {
+    if (aSorted.empty()) { return 0; }
+    size_t index = (size_t)(aPercentile * (double)aSorted.size());
+    if (index >= aSorted.size()) { index = aSorted.size() - 1; }
+    return (double)aSorted[index] / 1000000.0;
+}
+
+static void sReport(std::vector<std::unique_ptr<LoadThread>>& aThreads) {
+    LoadStats total = {};
+    for (auto& thread : aThreads) {
+        LoadStats& stats = thread->mStats;
+        for (int i = 0; i < LOAD_OP_MAX; i++) {
+            total.latencies[i].insert(total.latencies[i].end(), stats.latencies[i].begin(), stats.latencies[i].end());
+            total.sent[i] += stats.sent[i];
+            total.errors[i] += stats.errors[i];
+            total.timeouts[i] += stats.timeouts[i];
+        }
+        total.packetsSent += stats.packetsSent;
+        total.packetsReceived += stats.packetsReceived;
+        total.bytesSent += stats.bytesSent;
+        total.bytesReceived += stats.bytesReceived;
+        total.disconnects += stats.disconnects;
+    }
+
+    double seconds = (double)sSettings.seconds;
+    printf("\n%-16s %10s %10s %10s %10s %10s %10s %8s %8s\n",
+        "packet", "sent", "answered", "per sec", "p50 ms", "p99 ms", "p999 ms", "errors", "timeouts");
+    for (int i = 0; i < LOAD_OP_MAX; i++) {
+        std::vector<uint64_t>& latencies = total.latencies[i];
+        std::sort(latencies.begin(), latencies.end());
+        printf("%-16s %10" PRIu64 " %10" PRIu64 " %10.1f %10.3f %10.3f %10.3f %8" PRIu64 " %8" PRIu64 "\n",
+            sOpPackets[i],
+            total.sent[i],
+            (uint64_t)latencies.size(),
+            (double)total.sent[i] / seconds,
+            sPercentileMs(latencies, 0.5),
+            sPercentileMs(latencies, 0.99),
+            sPercentileMs(latencies, 0.999),
+            total.errors[i],
+            total.timeouts[i]);
+    }
+
+    printf("\npackets sent     %12" PRIu64 " (%.1f/s, %.2f MB/s)\n", total.packetsSent,
+        (double)total.packetsSent / seconds, (double)total.bytesSent / seconds / 1000000.0);
+    printf("packets received %12" PRIu64 " (%.1f/s, %.2f MB/s)\n", total.packetsReceived,
+        (double)total.packetsReceived / seconds, (double)total.bytesReceived / seconds / 1000000.0);
+    printf("disconnects      %12" PRIu64 "\n", total.disconnects);
+}
+
+static void sUsage(void) {
+    printf("usage: loadgen [--host=%s] [--port=%u] [--clients=%u] [--threads=%u] [--seconds=%u]\n"
+           "               [--rate=<ops per second per client>] [--lobby-size=%u] [--mix=%s]\n",
+        HOST, PORT, DEFAULT_CLIENTS, DEFAULT_THREADS, DEFAULT_SECONDS, DEFAULT_LOBBY_SIZE, DEFAULT_MIX);
+}
+
+int main(int argc, char *argv[]) {
+    sSettings.host = HOST;
+    sSettings.port = PORT;
+    sSettings.clients = DEFAULT_CLIENTS;
+    sSettings.threads = DEFAULT_THREADS;
+    sSettings.seconds = DEFAULT_SECONDS;
+    sSettings.rate = DEFAULT_RATE;
+    sSettings.lobbySize = DEFAULT_LOBBY_SIZE;
+    sParseMix(DEFAULT_MIX, sSettings.mix);
+
+    for (int i = 1; i < argc; i++) {
+        if (!strncmp(argv[i], "--host=", 7)) {
+            sSettings.host = argv[i] + 7;
+        } else if (!strncmp(argv[i], "--port=", 7)) {
+            sSettings.port = (uint16_t)atoi(argv[i] + 7);
+        } else if (!strncmp(argv[i], "--clients=", 10)) {
+            sSettings.clients = (uint32_t)atoi(argv[i] + 10);
+        } else if (!strncmp(argv[i], "--threads=", 10)) {
+            sSettings.threads = (uint32_t)atoi(argv[i] + 10);
+        } else if (!strncmp(argv[i], "--seconds=", 10)) {
+            sSettings.seconds = (uint32_t)atoi(argv[i] + 10);
+        } else if (!strncmp(argv[i], "--rate=", 7)) {
+            sSettings.rate = atof(argv[i] + 7);
+        } else if (!strncmp(argv[i], "--lobby-size=", 13)) {
+            sSettings.lobbySize = (uint32_t)atoi(argv[i] + 13);
+        } else if (!strncmp(argv[i], "--mix=", 6)) {
+            if (!sParseMix(argv[i] + 6, sSettings.mix)) {
+                printf("Invalid mix: %s\n", argv[i] + 6);
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            sUsage();
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (sSettings.clients == 0 || sSettings.threads == 0 || sSettings.seconds == 0 || sSettings.rate <= 0 || sSettings.lobbySize == 0) {
+        sUsage();
+        exit(EXIT_FAILURE);
+    }
+    if (sSettings.threads > sSettings.clients) { sSettings.threads = sSettings.clients; }
+
+    // resolve once, not for each of the thousands of connects
+    sSettings.address = GetAddrFromDomain(sSettings.host);
+
+    uint32_t groups = (sSettings.clients + sSettings.lobbySize - 1) / sSettings.lobbySize;
+    sGroupLobbies.reset(new std::atomic<uint64_t>[groups]);
+    sUserIds.reset(new std::atomic<uint64_t>[sSettings.clients]);
+    for (uint32_t i = 0; i < groups; i++) { sGroupLobbies[i] = 0; }
+    for (uint32_t i = 0; i < sSettings.clients; i++) { sUserIds[i] = 0; }
+
+    // threads get whole groups where possible so most relays stay on one thread
+    std::vector<std::unique_ptr<LoadThread>> loadThreads;
+    std::vector<std::thread> threads;
+    std::atomic<bool> failed(false);
+    uint64_t connectStart = sNowNs();
+    for (uint32_t i = 0; i < sSettings.threads; i++) {
+        uint32_t first = (uint32_t)((uint64_t)groups * i / sSettings.threads) * sSettings.lobbySize;
+        uint32_t last = (uint32_t)((uint64_t)groups * (i + 1) / sSettings.threads) * sSettings.lobbySize;
+        if (last > sSettings.clients) { last = sSettings.clients; }
+        if (first >= last) { continue; }
+        LoadThread* loadThread = new LoadThread();
+        loadThreads.emplace_back(loadThread);
+        threads.emplace_back([loadThread, first, last, &failed]() {
+            if (!loadThread->Setup(first, last - first)) { failed = true; }
+            sThreadsReady++;
+            while (sStartNs.load() == 0) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+            if (!failed) { loadThread->Run(); }
+        });
+    }
+
+    while (sThreadsReady.load() < threads.size()) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+    uint64_t connectEnd = sNowNs();
+    if (failed) {
+        sStartNs = 1;
+        for (auto& it : threads) { it.join(); }
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Connected %u clients in %.1f ms, running for %u seconds on %u threads against %s:%u\n",
+        sSettings.clients, (double)(connectEnd - connectStart) / 1000000.0, sSettings.seconds, (uint32_t)threads.size(),
+        sSettings.host.c_str(), (uint32_t)sSettings.port);
+    sStartNs = connectEnd;
+
+    for (auto& it : threads) { it.join(); }
+    sReport(loadThreads);
+
+    return 0;
+}
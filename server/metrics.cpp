@@ -3,145 +3,216 @@
 #include <ctime>
 #include <fstream>
 #include <iostream>
+#include <cinttypes>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
 #include "metrics.hpp"
 #include "json.hpp"
 #include "logging.hpp"
 
 using json = nlohmann::json;
 
-TimePeriod::TimePeriod(TimePeriod* aParent, std::string aPath, uint64_t aSeconds, uint64_t aLimit) {
-    mParent = aParent;
-    mPath = aPath;
-    mSeconds = aSeconds;
-    mLimit = aLimit;
-
-    std::ifstream f(mPath);
-    json j = json::parse(f);
-    mEpoch = j["epoch"].get<uint64_t>();
-    mLobbies = j["lobbies"].get<std::vector<int>>();
-    mPlayers = j["players"].get<std::vector<int>>();
-
-    while (mLobbies.size() < mPlayers.size()) { mLobbies.push_back(0); }
-    while (mPlayers.size() < mLobbies.size()) { mPlayers.push_back(0); }
+static uint64_t sNow() {
+    std::chrono::system_clock::time_point nowTp = std::chrono::system_clock::now();
+    return std::chrono::system_clock::to_time_t(nowTp);
 }
 
-uint64_t TimePeriod::LatestEntryTime() {
-    return mEpoch + (mLobbies.size() - 1) * mSeconds;
+TimePeriod::TimePeriod(TimePeriod* aParent, std::string aName, uint64_t aSeconds) {
+    mParent = aParent;
+    mName = aName;
+    mSeconds = aSeconds;
 }
 
-bool TimePeriod::NeedsEntry() {
-    std::chrono::system_clock::time_point nowTp = std::chrono::system_clock::now();
-    uint64_t now = std::chrono::system_clock::to_time_t(nowTp);
-    return (LatestEntryTime() + mSeconds < now);
-}
+bool TimePeriod::Begin(uint64_t aLimit) {
+    // a new ring starts at the beginning of the current period
+    uint64_t epoch = (sNow() / mSeconds) * mSeconds;
+    std::string path = std::string(METRICS_DIRECTORY) + "/" + mName + ".ring";
+    if (!mRing.Open(path, sizeof(TimePeriodRecord), aLimit, mSeconds, epoch)) {
+        LOG_ERROR("Could not open %s", path.c_str());
+        return false;
+    }
 
-int TimePeriod::LargestLobbiesInRange(uint64_t aStart, uint64_t aEnd) {
-    int largest = 0;
-    uint64_t time = mEpoch;
-    for (auto it : mLobbies) {
-        if (time >= aStart && time <= aEnd) {
-            if (largest < it) { largest = it; }
-        }
-        time += mSeconds;
+    // carry over what the website used to keep
+    if (mRing.Count() == 0) {
+        Import("website/" + mName + ".json");
     }
-    return largest;
+
+    mPlayersSketch.Reset(0.95);
+    return true;
 }
 
-int TimePeriod::LargestPlayersInRange(uint64_t aStart, uint64_t aEnd) {
-    int largest = 0;
-    uint64_t time = mEpoch;
-    for (auto it : mPlayers) {
-        if (time >= aStart && time <= aEnd) {
-            if (largest < it) { largest = it; }
+void TimePeriod::Import(const std::string& aPath) {
+    std::ifstream f(aPath);
+    if (!f.good()) { return; }
+
+    // only the most lobbies and players were kept back then
+    try {
+        json j = json::parse(f);
+        std::vector<int> lobbies = j["lobbies"].get<std::vector<int>>();
+        std::vector<int> players = j["players"].get<std::vector<int>>();
+        mRing.Reset(j["epoch"].get<uint64_t>());
+        for (size_t i = 0; i < lobbies.size() || i < players.size(); i++) {
+            TimePeriodRecord* record = (TimePeriodRecord*)mRing.Append();
+            record->lobbies = (i < lobbies.size()) ? lobbies[i] : 0;
+            record->players = (i < players.size()) ? players[i] : 0;
         }
-        time += mSeconds;
+        mRing.Sync();
+        LOG_INFO("Imported %" PRIu64 " entries from %s", (uint64_t)mRing.Count(), aPath.c_str());
+    } catch (...) {
+        LOG_ERROR("Failed to import %s", aPath.c_str());
     }
-    return largest;
 }
 
-void TimePeriod::Insert(int aLobbies, int aPlayers) {
-    mLobbies.push_back(aLobbies);
-    mPlayers.push_back(aPlayers);
-    mAltered = true;
+uint64_t TimePeriod::LatestEntryTime() {
+    return mRing.Epoch() + (mRing.Count() - 1) * mSeconds;
 }
 
-void TimePeriod::Update() {
-    while (mParent != nullptr && mParent->NeedsEntry()) {
-        uint64_t start = mParent->LatestEntryTime();
-        uint64_t end   = start + mParent->mSeconds;
-        int lobbies = LargestLobbiesInRange(start, end);
-        int players = LargestPlayersInRange(start, end);
-        mParent->Insert(lobbies, players);
+void TimePeriod::Add(uint64_t aTime, int aLobbies, int aPlayers) {
+    // the entry this sample belongs to
+    uint64_t time = ((aTime + mSeconds - 1) / mSeconds) * mSeconds;
+
+    if (mRing.Count() == 0 || time >= LatestEntryTime() + mRing.Capacity() * mSeconds) {
+        // nothing kept would survive the gap
+        mRing.Reset(time);
+        mRing.Append();
+        mPlayersSketch.Reset(0.95);
+    } else if (time > LatestEntryTime()) {
+        // the newest entry is done, anything in between had no samples at all
+        while (LatestEntryTime() < time) { mRing.Append(); }
+        mPlayersSketch.Reset(0.95);
     }
 
-    if (mParent != nullptr) {
-        mParent->Update();
-    }
+    // a clock that went backwards just keeps adding to the newest entry
+    TimePeriodRecord* record = (TimePeriodRecord*)mRing.At(mRing.Count() - 1);
+    if (record->samples == 0 || record->minLobbies > aLobbies) { record->minLobbies = aLobbies; }
+    if (record->samples == 0 || record->minPlayers > aPlayers) { record->minPlayers = aPlayers; }
+    if (record->lobbies < aLobbies) { record->lobbies = aLobbies; }
+    if (record->players < aPlayers) { record->players = aPlayers; }
+    record->sumLobbies += aLobbies;
+    record->sumPlayers += aPlayers;
+    record->samples++;
 
-    while (mLobbies.size() > mLimit) {
-        mLobbies.erase(mLobbies.begin());
-        mPlayers.erase(mPlayers.begin());
-        mEpoch += mSeconds;
-        mAltered = true;
-    }
+    mPlayersSketch.Add(aPlayers);
+    record->p95Players = (int32_t)(mPlayersSketch.Estimate() + 0.5);
 
-    if (mAltered) {
-        mAltered = false;
-        Save();
+    if (mParent != nullptr) {
+        mParent->Add(aTime, aLobbies, aPlayers);
     }
 }
 
-void TimePeriod::Save() {
-    // Create a JSON object and assign the vectors to it
-    nlohmann::json j;
-    j["epoch"] = mEpoch;
-    j["lobbies"] = mLobbies;
-    j["players"] = mPlayers;
-
-    // Serialize the JSON object to a string
-    std::string json_string = j.dump(4);
+void TimePeriod::Sync() {
+    mRing.Sync();
+}
 
-    // Write the JSON string to a file
-    try {
-        std::ofstream outfile(mPath);
-        outfile << json_string;
-        outfile.close();
-    } catch (...) {
-        LOG_ERROR("Failed to save %s", mPath.c_str());
+void TimePeriod::Export(MetricsSeries& aSeries) {
+    aSeries = MetricsSeries();
+    aSeries.name = mName;
+    aSeries.epoch = mRing.Epoch();
+    aSeries.seconds = mSeconds;
+    for (uint64_t i = 0; i < mRing.Count(); i++) {
+        TimePeriodRecord* record = (TimePeriodRecord*)mRing.At(i);
+        aSeries.lobbies.push_back(record->lobbies);
+        aSeries.players.push_back(record->players);
+        aSeries.minLobbies.push_back(record->minLobbies);
+        aSeries.minPlayers.push_back(record->minPlayers);
+        aSeries.avgLobbies.push_back(record->samples ? (double)record->sumLobbies / record->samples : 0);
+        aSeries.avgPlayers.push_back(record->samples ? (double)record->sumPlayers / record->samples : 0);
+        aSeries.p95Players.push_back(record->p95Players);
+        aSeries.samples.push_back(record->samples);
     }
 }
 
 Metrics::Metrics() {
-    std::ifstream file("website/hourly.json");
-    if (!file.good()) {
+#ifdef _WIN32
+    _mkdir(METRICS_DIRECTORY);
+#else
+    mkdir(METRICS_DIRECTORY, 0755);
+#endif
+
+    mWeekly   = new TimePeriod(nullptr,   "weekly",   60 * 60 * 24 * 7);
+    mDaily    = new TimePeriod(mWeekly,   "daily",    60 * 60 * 24);
+    mHourly   = new TimePeriod(mDaily,    "hourly",   60 * 60);
+    mMinutely = new TimePeriod(mHourly,   "minutely", 60);
+    mSecondly = new TimePeriod(mMinutely, "secondly", 1);
+
+    bool opened = mWeekly->Begin(48)
+               && mDaily->Begin(48)
+               && mHourly->Begin(48)
+               && mMinutely->Begin(60 * 24)
+               && mSecondly->Begin(60 * 60);
+    if (!opened) {
         LOG_ERROR("Could not start metrics.");
+        mSecondly = nullptr;
         return;
     }
 
-    mWeekly = new TimePeriod(nullptr, "website/weekly.json", 60 * 60 * 24 * 7, 48);
-    mDaily  = new TimePeriod(mWeekly, "website/daily.json", 60 * 60 * 24, 48);
-    mHourly = new TimePeriod(mDaily,  "website/hourly.json", 60 * 60, 48);
+    LOG_INFO("Started metrics.");
+}
 
-    while (mHourly->NeedsEntry()) {
-        mHourly->Insert(0, 0);
+void Metrics::Update(int aLobbies, int aPlayers, const std::map<std::string, GameCount>& aGames) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    mCurrentLobbies = aLobbies;
+    mCurrentPlayers = aPlayers;
+    mCurrentGames = aGames;
+
+    if (mSecondly == nullptr) { return; }
+    uint64_t now = sNow();
+    mSecondly->Add(now, aLobbies, aPlayers);
+
+    if (now >= mNextSave) {
+        mNextSave = now + METRICS_SAVE_SECS;
+        Save(aLobbies, aPlayers);
+        for (auto it : { mSecondly, mMinutely, mHourly, mDaily, mWeekly }) {
+            it->Sync();
+        }
     }
-    mHourly->Update();
-    LOG_INFO("Started metrics.");
 }
 
-void Metrics::Update(int aLobbies, int aPlayers) {
-    if (mHourly == nullptr) { return; }
-    if (mLobbies < aLobbies) { mLobbies = aLobbies; }
-    if (mPlayers < aPlayers) { mPlayers = aPlayers; }
+void Metrics::UpdatePending(int aPending) {
+    // only ever shown as it is right now, there's no series for it
+    std::lock_guard<std::mutex> guard(mMutex);
+    mCurrentPending = aPending;
+}
+
+void Metrics::Current(int* aLobbies, int* aPlayers) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    *aLobbies = mCurrentLobbies;
+    *aPlayers = mCurrentPlayers;
+}
 
-    if (mHourly->NeedsEntry()) {
-        mHourly->Insert(mLobbies, mPlayers);
-        mHourly->Update();
-        mLobbies = aLobbies;
-        mPlayers = aPlayers;
+void Metrics::Games(std::map<std::string, GameCount>& aGames) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    aGames = mCurrentGames;
+}
+
+int Metrics::Pending() {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mCurrentPending;
+}
+
+void Metrics::Series(std::vector<MetricsSeries>& aSeries) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    aSeries.clear();
+    if (mSecondly == nullptr) { return; }
+
+    for (auto it : { mSecondly, mMinutely, mHourly, mDaily, mWeekly }) {
+        aSeries.push_back(MetricsSeries());
+        it->Export(aSeries.back());
     }
+}
 
-    Save(aLobbies, aPlayers);
+bool Metrics::Series(const std::string& aName, MetricsSeries& aSeries) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    if (mSecondly == nullptr) { return false; }
+
+    for (auto it : { mSecondly, mMinutely, mHourly, mDaily, mWeekly }) {
+        if (it->Name() != aName) { continue; }
+        it->Export(aSeries);
+        return true;
+    }
+    return false;
 }
 
 void Metrics::Save(int aLobbies, int aPlayers) {
@@ -1,26 +1,67 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <map>
+#include <mutex>
+#include "ringfile.hpp"
+#include "quantile.hpp"
+#include "server.hpp"
 
+// current.json is still written for the website, just not on every update
+#define METRICS_SAVE_SECS 20
+#define METRICS_DIRECTORY "metrics"
+
+typedef struct {
+    std::string name;
+    uint64_t epoch;
+    uint64_t seconds;
+    std::vector<int> lobbies;
+    std::vector<int> players;
+    std::vector<int> minLobbies;
+    std::vector<int> minPlayers;
+    std::vector<double> avgLobbies;
+    std::vector<double> avgPlayers;
+    std::vector<int> p95Players;
+    std::vector<uint32_t> samples;
+} MetricsSeries;
+
+// lobbies and players hold the most seen, they come first so older files still line up
+typedef struct {
+    int32_t lobbies;
+    int32_t players;
+    int32_t minLobbies;
+    int32_t minPlayers;
+    int64_t sumLobbies;
+    int64_t sumPlayers;
+    int32_t p95Players;
+    uint32_t samples;
+} TimePeriodRecord;
+
+// One resolution of the metrics, the newest aLimit entries are kept in a ring file.
+// An entry at time T covers the samples after T - aSeconds up to T. Every sample
+// is folded into the newest entry as it arrives, and passed on to the parent,
+// so nothing is ever rescanned. The newest entry stays open until a sample
+// for a later one shows up.
 class TimePeriod {
     private:
         TimePeriod* mParent = nullptr;
-        std::string mPath = "";
+        std::string mName = "";
         uint64_t mSeconds = 0;
-        uint64_t mLimit = 0;
-        uint64_t mEpoch = 0;
-        bool mAltered = false;
-        std::vector<int> mLobbies;
-        std::vector<int> mPlayers;
-    public:
-        TimePeriod(TimePeriod* parent, std::string aPath, uint64_t aSeconds, uint64_t aLimit);
+        RingFile mRing;
+
+        // p95 of the open entry, it starts over if the server restarts in the middle of one
+        QuantileSketch mPlayersSketch;
+
+        void Import(const std::string& aPath);
         uint64_t LatestEntryTime();
-        bool NeedsEntry();
-        int LargestLobbiesInRange(uint64_t aStart, uint64_t aEnd);
-        int LargestPlayersInRange(uint64_t aStart, uint64_t aEnd);
-        void Insert(int aLobbies, int aPlayers);
-        void Update();
-        void Save();
+    public:
+        TimePeriod(TimePeriod* parent, std::string aName, uint64_t aSeconds);
+        bool Begin(uint64_t aLimit);
+        void Add(uint64_t aTime, int aLobbies, int aPlayers);
+        void Sync();
+
+        const std::string& Name() { return mName; }
+        void Export(MetricsSeries& aSeries);
 };
 
 class Metrics {
@@ -28,10 +69,25 @@ class Metrics {
         TimePeriod* mWeekly = nullptr;
         TimePeriod* mDaily = nullptr;
         TimePeriod* mHourly = nullptr;
-        int mLobbies = 0;
-        int mPlayers = 0;
+        TimePeriod* mMinutely = nullptr;
+        TimePeriod* mSecondly = nullptr;
+        int mCurrentLobbies = 0;
+        int mCurrentPlayers = 0;
+        std::map<std::string, GameCount> mCurrentGames;
+        int mCurrentPending = 0;
+        uint64_t mNextSave = 0;
+
+        // updates come from the main loop, reads from the stats listener
+        std::mutex mMutex;
     public:
         Metrics();
-        void Update(int aLobbies, int aPlayers);
+        void Update(int aLobbies, int aPlayers, const std::map<std::string, GameCount>& aGames);
+        void UpdatePending(int aPending);
         void Save(int aLobbies, int aPlayers);
+
+        void Current(int* aLobbies, int* aPlayers);
+        void Games(std::map<std::string, GameCount>& aGames);
+        int Pending();
+        void Series(std::vector<MetricsSeries>& aSeries);
+        bool Series(const std::string& aName, MetricsSeries& aSeries);
 };
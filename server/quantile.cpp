@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <cmath>
+#include "quantile.hpp"
+
+void QuantileSketch::Reset(double aQuantile) {
+    mQuantile = aQuantile;
+    mCount = 0;
+    for (int i = 0; i < QUANTILE_MARKERS; i++) {
+        mHeights[i] = 0;
+        mPositions[i] = i;
+    }
+
+    // where the markers should sit: the minimum, halfway to the quantile, the quantile, halfway to the maximum, the maximum
+    double q = aQuantile;
+    double desired[QUANTILE_MARKERS] = { 0, 2 * q, 4 * q, 2 + 2 * q, 4 };
+    double increments[QUANTILE_MARKERS] = { 0, q / 2, q, (1 + q) / 2, 1 };
+    for (int i = 0; i < QUANTILE_MARKERS; i++) {
+        mDesired[i] = desired[i];
+        mIncrements[i] = increments[i];
+    }
+}
+
+double QuantileSketch::Parabolic(int aIndex, double aDirection) {
+    double n0 = mPositions[aIndex - 1];
+    double n1 = mPositions[aIndex];
+    double n2 = mPositions[aIndex + 1];
+    double q0 = mHeights[aIndex - 1];
+    double q1 = mHeights[aIndex];
+    double q2 = mHeights[aIndex + 1];
+    return q1 + aDirection / (n2 - n0) * ((n1 - n0 + aDirection) * (q2 - q1) / (n2 - n1) + (n2 - n1 - aDirection) * (q1 - q0) / (n1 - n0));
+}
+
+double QuantileSketch::Linear(int aIndex, double aDirection) {
+    int other = aIndex + (int)aDirection;
+    return mHeights[aIndex] + aDirection * (mHeights[other] - mHeights[aIndex]) / (mPositions[other] - mPositions[aIndex]);
+}
+
+void QuantileSketch::Add(double aValue) {
+    // the first samples are simply kept in order
+    if (mCount < QUANTILE_MARKERS) {
+        mHeights[mCount++] = aValue;
+        std::sort(mHeights, mHeights + mCount);
+        return;
+    }
+    mCount++;
+
+    // find the cell the sample falls in, stretching the ends if it's outside of them
+    int cell = 0;
+    if (aValue < mHeights[0]) {
+        mHeights[0] = aValue;
+        cell = 0;
+    } else if (aValue >= mHeights[QUANTILE_MARKERS - 1]) {
+        mHeights[QUANTILE_MARKERS - 1] = aValue;
+        cell = QUANTILE_MARKERS - 2;
+    } else {
+        while (cell < QUANTILE_MARKERS - 2 && aValue >= mHeights[cell + 1]) { cell++; }
+    }
+
+    for (int i = cell + 1; i < QUANTILE_MARKERS; i++) { mPositions[i]++; }
+    for (int i = 0; i < QUANTILE_MARKERS; i++) { mDesired[i] += mIncrements[i]; }
+
+    // move the middle markers that drifted a whole position away from where they should be
+    for (int i = 1; i < QUANTILE_MARKERS - 1; i++) {
+        double drift = mDesired[i] - mPositions[i];
+        bool up = (drift >= 1 && mPositions[i + 1] - mPositions[i] > 1);
+        bool down = (drift <= -1 && mPositions[i - 1] - mPositions[i] < -1);
+        if (!up && !down) { continue; }
+
+        double direction = up ? 1.0 : -1.0;
+        double height = Parabolic(i, direction);
+        if (mHeights[i - 1] < height && height < mHeights[i + 1]) {
+            mHeights[i] = height;
+        } else {
+            mHeights[i] = Linear(i, direction);
+        }
+        mPositions[i] += direction;
+    }
+}
+
+double QuantileSketch::Estimate() {
+    if (mCount == 0) { return 0; }
+
+    // with only a few samples, pick the nearest one
+    if (mCount <= QUANTILE_MARKERS) {
+        size_t index = (size_t)std::lround(mQuantile * (mCount - 1));
+        return mHeights[index];
+    }
+    return mHeights[2];
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+#define QUANTILE_MARKERS 5
+
+// Estimates one quantile of a stream without keeping the stream, using the
+// P-squared algorithm (Jain & Chlamtac): five markers whose heights are
+// nudged along a parabola as samples arrive, so it's O(1) time and memory.
+// Exact until there are more than five samples.
+class QuantileSketch {
+    private:
+        double mQuantile = 0.5;
+        double mHeights[QUANTILE_MARKERS];
+        double mPositions[QUANTILE_MARKERS];
+        double mDesired[QUANTILE_MARKERS];
+        double mIncrements[QUANTILE_MARKERS];
+        uint64_t mCount = 0;
+
+        double Parabolic(int aIndex, double aDirection);
+        double Linear(int aIndex, double aDirection);
+
+    public:
+        QuantileSketch(double aQuantile = 0.5) { Reset(aQuantile); }
+
+        void Reset(double aQuantile);
+        void Add(double aValue);
+        double Estimate();
+        uint64_t Count() { return mCount; }
+};
@@ -0,0 +1,185 @@
+#include <cstring>
+#include <cstdio>
+#include <cinttypes>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "ringfile.hpp"
+#include "logging.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+RingFile::~RingFile() {
+    Unmap();
+}
+
+bool RingFile::Map(bool aCreate, uint32_t aRecordSize, uint64_t aCapacity, uint64_t aSeconds) {
+    size_t size = sizeof(RingFileHeader) + (size_t)aRecordSize * aCapacity;
+
+#ifdef _WIN32
+    // no mapping here, the whole file is kept in memory and written back on Sync()
+    FILE* file = fopen(mPath.c_str(), aCreate ? "wb+" : "rb+");
+    if (!file) { return false; }
+    if (!aCreate) {
+        fseek(file, 0, SEEK_END);
+        size = (size_t)ftell(file);
+        fseek(file, 0, SEEK_SET);
+    }
+    if (size < sizeof(RingFileHeader)) { fclose(file); return false; }
+    uint8_t* data = (uint8_t*)calloc(1, size);
+    if (!aCreate && fread(data, 1, size, file) != size) { free(data); fclose(file); return false; }
+    fclose(file);
+#else
+    mFile = open(mPath.c_str(), O_RDWR | (aCreate ? (O_CREAT | O_TRUNC) : 0), 0644);
+    if (mFile < 0) { return false; }
+
+    if (aCreate) {
+        if (ftruncate(mFile, (off_t)size) != 0) { Unmap(); return false; }
+    } else {
+        struct stat st;
+        if (fstat(mFile, &st) != 0) { Unmap(); return false; }
+        size = (size_t)st.st_size;
+    }
+    if (size < sizeof(RingFileHeader)) { Unmap(); return false; }
+
+    void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, mFile, 0);
+    if (mapped == MAP_FAILED) { Unmap(); return false; }
+    uint8_t* data = (uint8_t*)mapped;
+#endif
+
+    mMapSize = size;
+    mHeader = (RingFileHeader*)data;
+    mRecords = data + sizeof(RingFileHeader);
+
+    if (aCreate) {
+        mHeader->magic = RINGFILE_MAGIC;
+        mHeader->version = RINGFILE_VERSION;
+        mHeader->recordSize = aRecordSize;
+        mHeader->capacity = aCapacity;
+        mHeader->seconds = aSeconds;
+        mHeader->epoch = 0;
+        mHeader->head = 0;
+        mHeader->count = 0;
+        return true;
+    }
+
+    // whatever is in there has to at least describe itself correctly
+    bool valid = (mHeader->magic == RINGFILE_MAGIC)
+              && (mHeader->version == RINGFILE_VERSION)
+              && (mHeader->recordSize > 0 && mHeader->capacity > 0)
+              && (mMapSize >= sizeof(RingFileHeader) + (size_t)mHeader->recordSize * mHeader->capacity)
+              && (mHeader->count <= mHeader->capacity && mHeader->head < mHeader->capacity);
+    if (!valid) {
+        Unmap();
+        return false;
+    }
+    return true;
+}
+
+void RingFile::Unmap() {
+    if (mHeader) {
+#ifdef _WIN32
+        Sync();
+        free(mHeader);
+#else
+        munmap(mHeader, mMapSize);
+#endif
+    }
+#ifndef _WIN32
+    if (mFile >= 0) { close(mFile); }
+#endif
+    mHeader = nullptr;
+    mRecords = nullptr;
+    mMapSize = 0;
+    mFile = -1;
+}
+
+bool RingFile::Open(const std::string& aPath, uint32_t aRecordSize, uint64_t aCapacity, uint64_t aSeconds, uint64_t aEpoch) {
+    Unmap();
+    mPath = aPath;
+
+    std::vector<uint8_t> old;
+    uint32_t oldRecordSize = 0;
+    uint64_t oldCount = 0;
+    uint64_t oldEpoch = 0;
+
+    if (Map(false, aRecordSize, aCapacity, aSeconds)) {
+        if (mHeader->recordSize == aRecordSize && mHeader->capacity == aCapacity && mHeader->seconds == aSeconds) {
+            return true;
+        }
+
+        // the layout changed, hold on to the records so they can be copied into the new one
+        if (mHeader->seconds == aSeconds) {
+            oldRecordSize = mHeader->recordSize;
+            oldCount = mHeader->count;
+            oldEpoch = mHeader->epoch;
+            old.resize((size_t)oldRecordSize * oldCount);
+            for (uint64_t i = 0; i < oldCount; i++) {
+                memcpy(&old[(size_t)i * oldRecordSize], At(i), oldRecordSize);
+            }
+        }
+        LOG_INFO("Resizing %s, keeping %" PRIu64 " records", mPath.c_str(), oldCount);
+        Unmap();
+    }
+
+    if (!Map(true, aRecordSize, aCapacity, aSeconds)) {
+        LOG_ERROR("Failed to create %s", mPath.c_str());
+        return false;
+    }
+    Reset(aEpoch);
+
+    // keep the newest records that fit, fields that are new start out zeroed
+    if (oldCount > 0) {
+        uint64_t skip = (oldCount > aCapacity) ? oldCount - aCapacity : 0;
+        Reset(oldEpoch + skip * aSeconds);
+        size_t size = (oldRecordSize < aRecordSize) ? oldRecordSize : aRecordSize;
+        for (uint64_t i = skip; i < oldCount; i++) {
+            memcpy(Append(), &old[(size_t)i * oldRecordSize], size);
+        }
+    }
+
+    Sync();
+    return true;
+}
+
+void RingFile::Reset(uint64_t aEpoch) {
+    mHeader->epoch = aEpoch;
+    mHeader->head = 0;
+    mHeader->count = 0;
+}
+
+void* RingFile::At(uint64_t aIndex) {
+    uint64_t slot = (mHeader->head + aIndex) % mHeader->capacity;
+    return &mRecords[(size_t)slot * mHeader->recordSize];
+}
+
+void* RingFile::Append() {
+    // full, the oldest record makes room
+    if (mHeader->count == mHeader->capacity) {
+        mHeader->head = (mHeader->head + 1) % mHeader->capacity;
+        mHeader->epoch += mHeader->seconds;
+        mHeader->count--;
+    }
+
+    void* record = At(mHeader->count);
+    memset(record, 0, mHeader->recordSize);
+    mHeader->count++;
+    return record;
+}
+
+void RingFile::Sync() {
+    if (!mHeader) { return; }
+#ifdef _WIN32
+    FILE* file = fopen(mPath.c_str(), "wb");
+    if (!file) { return; }
+    fwrite(mHeader, 1, mMapSize, file);
+    fclose(file);
+#else
+    msync(mHeader, mMapSize, MS_ASYNC);
+#endif
+}
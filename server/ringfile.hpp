@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#define RINGFILE_MAGIC 0x474e4952
+#define RINGFILE_VERSION 1
+
+// sits at the start of the file, the records follow it
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t unused;
+    uint64_t capacity;
+    uint64_t seconds;
+    uint64_t epoch;
+    uint64_t head;
+    uint64_t count;
+} RingFileHeader;
+
+// A file of fixed size records, one every aSeconds, mapped into memory.
+// Appending writes a single record in place, once the file is full the
+// oldest record is overwritten and the epoch moves forward.
+// The epoch is the time of the oldest record.
+// Not thread safe.
+class RingFile {
+    private:
+        std::string mPath;
+        RingFileHeader* mHeader = nullptr;
+        uint8_t* mRecords = nullptr;
+        size_t mMapSize = 0;
+        int mFile = -1;
+
+        bool Map(bool aCreate, uint32_t aRecordSize, uint64_t aCapacity, uint64_t aSeconds);
+        void Unmap();
+
+    public:
+        RingFile() {}
+        RingFile(const RingFile&) = delete;
+        RingFile& operator=(const RingFile&) = delete;
+        ~RingFile();
+
+        // opens or creates the file, a file with a different layout is copied over into a new one
+        bool Open(const std::string& aPath, uint32_t aRecordSize, uint64_t aCapacity, uint64_t aSeconds, uint64_t aEpoch);
+
+        uint64_t Count() { return mHeader->count; }
+        uint64_t Capacity() { return mHeader->capacity; }
+        uint64_t Epoch() { return mHeader->epoch; }
+
+        // empties the file, the next record appended is at aEpoch
+        void Reset(uint64_t aEpoch);
+
+        // aIndex 0 is the oldest record
+        void* At(uint64_t aIndex);
+        void* Append();
+
+        // ask the kernel to start writing dirty pages back, without waiting for it
+        void Sync();
+};
@@ -1,28 +1,80 @@
 #include <iostream>
+#include <cstring>
+#include <csignal>
 #include "server.hpp"
+#include "packetstats.hpp"
 #include "metrics.hpp"
+#include "stats.hpp"
 #include "extra/server_extra.hpp"
 #include "sha2.hpp"
 
 #define PORT 34197
 #define EXIT_FAILURE 1
+#define DEFAULT_WORKERS 1
+#define DEFAULT_STATS_PORT 34180
+#define EXTRA_UPDATE_SECS 20
+
+// kill -USR1 prints the packet counters and latencies
+static volatile sig_atomic_t sPrintPacketStats = 0;
+
+static void sOnPrintPacketStats(int aSignal) {
+    sPrintPacketStats = 1;
+}
 
 int main(int argc, char *argv[]) {
+    uint32_t workers = DEFAULT_WORKERS;
+    uint32_t statsPort = DEFAULT_STATS_PORT;
+    uint32_t admissionThreads = ADMISSION_DEFAULT_THREADS;
+    for (int i = 1; i < argc; i++) {
+        if (!strncmp(argv[i], "--workers=", 10)) {
+            workers = (uint32_t)atoi(argv[i] + 10);
+        } else if (!strncmp(argv[i], "--stats-port=", 13)) {
+            statsPort = (uint32_t)atoi(argv[i] + 13);
+        } else if (!strncmp(argv[i], "--admission-threads=", 20)) {
+            admissionThreads = (uint32_t)atoi(argv[i] + 20);
+        }
+    }
+
     Metrics metrics;
 
+    // a port of 0 turns the stats listener off, the server runs fine without it
+    StatsServer stats;
+    if (statsPort != 0) {
+        stats.Begin((uint16_t)statsPort, &metrics);
+    }
+
     gServer = new Server();
 
     gCoopNetCallbacks.DestIdFunction = sha224_u64;
     server_extra_init();
 
-    if (!gServer->Begin(PORT)) {
+    if (!gServer->Begin(PORT, workers, admissionThreads)) {
         exit(EXIT_FAILURE);
     }
 
+#ifdef SIGUSR1
+    signal(SIGUSR1, sOnPrintPacketStats);
+#endif
+
+    uint64_t tick = 0;
+    std::map<std::string, GameCount> games;
     while (true) {
-        metrics.Update(gServer->LobbyCount(), gServer->PlayerCount());
-        server_extra_update();
-        std::this_thread::sleep_for(std::chrono::milliseconds(20 * 1000));
+        // sampled every second so the stats listener is never more than a second behind
+        gServer->GameCounts(games);
+        metrics.Update(gServer->LobbyCount(), gServer->PlayerCount(), games);
+        metrics.UpdatePending((int)gServer->ConnectionPendingCount());
+        if ((tick % EXTRA_UPDATE_SECS) == 0) {
+            server_extra_update();
+        }
+
+        if (sPrintPacketStats) {
+            sPrintPacketStats = 0;
+            printf("%s", PacketStats::Format().c_str());
+            fflush(stdout);
+        }
+
+        tick++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
     }
 
     return 0;
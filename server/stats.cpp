@@ -0,0 +1,362 @@
+#include <cstring>
+#include <cinttypes>
+#include <vector>
+#include <map>
+#include "stats.hpp"
+#include "json.hpp"
+#include "logging.hpp"
+#include "socket.hpp"
+#include "packetstats.hpp"
+
+using json = nlohmann::json;
+
+#define STATS_REQUEST_MAX 4096
+#define STATS_TIMEOUT_SECS 2
+
+// the upper bounds of the prometheus latency buckets, in nanoseconds
+static const uint64_t sLatencyBounds[] = {
+    1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 100000000, 1000000000,
+};
+
+// game names come from clients, so they're escaped before going into a label
+static std::string sLabel(const std::string& aValue) {
+    std::string out;
+    for (char c : aValue) {
+        if (c == '\\' || c == '"') { out += '\\'; out += c; }
+        else if (c == '\n') { out += "\\n"; }
+        else { out += c; }
+    }
+    return out;
+}
+
+// laid out like the files the website used to read, lobbies and players are the most seen
+static void sSeriesJson(const MetricsSeries& aSeries, json& aJson) {
+    aJson["epoch"] = aSeries.epoch;
+    aJson["seconds"] = aSeries.seconds;
+    aJson["lobbies"] = aSeries.lobbies;
+    aJson["players"] = aSeries.players;
+    aJson["min_lobbies"] = aSeries.minLobbies;
+    aJson["min_players"] = aSeries.minPlayers;
+    aJson["avg_lobbies"] = aSeries.avgLobbies;
+    aJson["avg_players"] = aSeries.avgPlayers;
+    aJson["p95_players"] = aSeries.p95Players;
+    aJson["samples"] = aSeries.samples;
+}
+
+static void sReceiveStart(StatsServer* aStats) { aStats->Receive(); }
+
+static void sSendAll(int aSocket, const std::string& aData) {
+    size_t sent = 0;
+    while (sent < aData.size()) {
+        int ret = send(aSocket, aData.data() + sent, aData.size() - sent, MSG_NOSIGNAL);
+        if (ret <= 0) { return; }
+        sent += (size_t)ret;
+    }
+}
+
+static void sRespond(int aSocket, const char* aStatus, const char* aContentType, const std::string& aBody, bool aHead) {
+    char header[256];
+    snprintf(header, sizeof(header), "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %" PRIu64 "\r\nConnection: close\r\n\r\n",
+        aStatus, aContentType, (uint64_t)aBody.size());
+    sSendAll(aSocket, header);
+    if (!aHead) { sSendAll(aSocket, aBody); }
+}
+
+bool StatsServer::Begin(uint16_t aPort, Metrics* aMetrics) {
+    mMetrics = aMetrics;
+
+    mSocket = SocketInitialize(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (mSocket <= 0) {
+        LOG_ERROR("Stats socket failed (%d)!", mSocket);
+        return false;
+    }
+
+    int opt = 1;
+    setsockopt(mSocket, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
+
+    // only reachable from this machine
+    struct sockaddr_in address = { 0 };
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(aPort);
+    if (bind(mSocket, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        LOG_ERROR("Stats bind failed on port %u!", aPort);
+        SocketClose(mSocket);
+        return false;
+    }
+
+    if (listen(mSocket, SOMAXCONN) < 0) {
+        LOG_ERROR("Stats socket failed to listen!");
+        SocketClose(mSocket);
+        return false;
+    }
+
+    mThread = std::thread(sReceiveStart, this);
+    mThread.detach();
+    LOG_INFO("Stats listener on port %u", aPort);
+    return true;
+}
+
+void StatsServer::Receive() {
+    while (true) {
+        int socket = accept(mSocket, nullptr, nullptr);
+        if (socket < 0) {
+            LOG_ERROR("Failed to accept stats socket (%d)!", socket);
+            continue;
+        }
+        Respond(socket);
+        SocketClose(socket);
+    }
+}
+
+void StatsServer::Respond(int aSocket) {
+    // a scraper that never finishes its request shouldn't hold up the next one
+#ifdef _WIN32
+    DWORD timeout = STATS_TIMEOUT_SECS * 1000;
+#else
+    struct timeval timeout = { .tv_sec = STATS_TIMEOUT_SECS, .tv_usec = 0 };
+#endif
+    setsockopt(aSocket, SOL_SOCKET, SO_RCVTIMEO, (char*)&timeout, sizeof(timeout));
+
+    // only the request line matters, read until the end of the headers
+    std::string request;
+    char buffer[1024];
+    while (request.size() < STATS_REQUEST_MAX && request.find("\r\n\r\n") == std::string::npos) {
+        int ret = recv(aSocket, buffer, sizeof(buffer), 0);
+        if (ret <= 0) { break; }
+        request.append(buffer, (size_t)ret);
+    }
+
+    size_t methodEnd = request.find(' ');
+    size_t pathEnd = (methodEnd == std::string::npos) ? std::string::npos : request.find(' ', methodEnd + 1);
+    if (pathEnd == std::string::npos) {
+        sRespond(aSocket, "400 Bad Request", "text/plain", "bad request\n", false);
+        return;
+    }
+
+    std::string method = request.substr(0, methodEnd);
+    std::string path = request.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+    path = path.substr(0, path.find('?'));
+
+    bool head = (method == "HEAD");
+    if (method != "GET" && !head) {
+        sRespond(aSocket, "405 Method Not Allowed", "text/plain", "only GET is supported\n", false);
+        return;
+    }
+
+    if (path == "/metrics") {
+        sRespond(aSocket, "200 OK", "text/plain; version=0.0.4", Prometheus(), head);
+    } else if (path == "/stats.json") {
+        sRespond(aSocket, "200 OK", "application/json", Json(), head);
+    } else if (path.compare(0, 8, "/series/") == 0 && path.size() > 13 && path.compare(path.size() - 5, 5, ".json") == 0) {
+        std::string body;
+        if (SeriesJson(path.substr(8, path.size() - 13), body)) {
+            sRespond(aSocket, "200 OK", "application/json", body, head);
+        } else {
+            sRespond(aSocket, "404 Not Found", "text/plain", "unknown series\n", head);
+        }
+    } else {
+        sRespond(aSocket, "404 Not Found", "text/plain", "try /metrics, /stats.json or /series/hourly.json\n", head);
+    }
+}
+
+std::string StatsServer::Prometheus() {
+    int lobbies = 0;
+    int players = 0;
+    mMetrics->Current(&lobbies, &players);
+
+    std::map<std::string, GameCount> games;
+    mMetrics->Games(games);
+    int pending = mMetrics->Pending();
+
+    std::vector<MetricsSeries> series;
+    mMetrics->Series(series);
+
+    std::vector<PacketTypeStats> packets;
+    PacketStats::Snapshot(packets);
+
+    std::string out;
+    char line[256];
+
+    out += "# HELP coopnet_lobbies Lobbies open right now.\n";
+    out += "# TYPE coopnet_lobbies gauge\n";
+    snprintf(line, sizeof(line), "coopnet_lobbies %d\n", lobbies);
+    out += line;
+
+    out += "# HELP coopnet_players Players in a lobby right now.\n";
+    out += "# TYPE coopnet_players gauge\n";
+    snprintf(line, sizeof(line), "coopnet_players %d\n", players);
+    out += line;
+
+    out += "# HELP coopnet_admission_pending New connections waiting on the admission check right now.\n";
+    out += "# TYPE coopnet_admission_pending gauge\n";
+    snprintf(line, sizeof(line), "coopnet_admission_pending %d\n", pending);
+    out += line;
+
+    out += "# HELP coopnet_game_lobbies Lobbies open right now, per game.\n";
+    out += "# TYPE coopnet_game_lobbies gauge\n";
+    for (auto& it : games) {
+        out += "coopnet_game_lobbies{game=\"" + sLabel(it.first) + "\"} " + std::to_string(it.second.lobbies) + "\n";
+    }
+
+    out += "# HELP coopnet_game_players Players in a lobby right now, per game.\n";
+    out += "# TYPE coopnet_game_players gauge\n";
+    for (auto& it : games) {
+        out += "coopnet_game_players{game=\"" + sLabel(it.first) + "\"} " + std::to_string(it.second.players) + "\n";
+    }
+
+    // the newest entry of every series, which is still filling up, the whole history is in the json
+    struct {
+        const char* name;
+        const char* help;
+        std::vector<int> MetricsSeries::* field;
+    } periods[] = {
+        { "coopnet_period_lobbies", "Most lobbies open during the newest entry of each period.", &MetricsSeries::lobbies },
+        { "coopnet_period_players", "Most players in a lobby during the newest entry of each period.", &MetricsSeries::players },
+        { "coopnet_period_min_lobbies", "Fewest lobbies open during the newest entry of each period.", &MetricsSeries::minLobbies },
+        { "coopnet_period_min_players", "Fewest players in a lobby during the newest entry of each period.", &MetricsSeries::minPlayers },
+        { "coopnet_period_p95_players", "95th percentile of players in a lobby during the newest entry of each period.", &MetricsSeries::p95Players },
+    };
+    for (auto& period : periods) {
+        snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s gauge\n", period.name, period.help, period.name);
+        out += line;
+        for (auto& it : series) {
+            const std::vector<int>& values = it.*period.field;
+            if (values.empty()) { continue; }
+            snprintf(line, sizeof(line), "%s{period=\"%s\"} %d\n", period.name, it.name.c_str(), values.back());
+            out += line;
+        }
+    }
+
+    struct {
+        const char* name;
+        const char* help;
+        std::vector<double> MetricsSeries::* field;
+    } averages[] = {
+        { "coopnet_period_avg_lobbies", "Average lobbies open during the newest entry of each period.", &MetricsSeries::avgLobbies },
+        { "coopnet_period_avg_players", "Average players in a lobby during the newest entry of each period.", &MetricsSeries::avgPlayers },
+    };
+    for (auto& average : averages) {
+        snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s gauge\n", average.name, average.help, average.name);
+        out += line;
+        for (auto& it : series) {
+            const std::vector<double>& values = it.*average.field;
+            if (values.empty()) { continue; }
+            snprintf(line, sizeof(line), "%s{period=\"%s\"} %.3f\n", average.name, it.name.c_str(), values.back());
+            out += line;
+        }
+    }
+
+    // one counter per packet type
+    struct {
+        const char* name;
+        const char* help;
+        uint64_t PacketTypeStats::* field;
+    } counters[] = {
+        { "coopnet_packets_received_total", "Packets received.", &PacketTypeStats::packetsIn },
+        { "coopnet_packet_bytes_received_total", "Bytes of packets received.", &PacketTypeStats::bytesIn },
+        { "coopnet_packets_sent_total", "Packets sent.", &PacketTypeStats::packetsOut },
+        { "coopnet_packet_bytes_sent_total", "Bytes of packets sent.", &PacketTypeStats::bytesOut },
+        { "coopnet_packet_parse_errors_total", "Packets that could not be decoded.", &PacketTypeStats::parseErrors },
+        { "coopnet_packet_receive_errors_total", "Packets that were rejected or failed to be handled.", &PacketTypeStats::receiveErrors },
+    };
+    for (auto& counter : counters) {
+        snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s counter\n", counter.name, counter.help, counter.name);
+        out += line;
+        for (uint16_t i = 0; i < MPACKET_MAX; i++) {
+            snprintf(line, sizeof(line), "%s{type=\"%s\"} %" PRIu64 "\n", counter.name, PacketStats::Name(i), packets[i].*counter.field);
+            out += line;
+        }
+    }
+
+    // the histogram buckets folded into the usual prometheus bounds
+    out += "# HELP coopnet_packet_process_seconds Time spent decoding and handling a received packet.\n";
+    out += "# TYPE coopnet_packet_process_seconds histogram\n";
+    for (uint16_t i = 0; i < MPACKET_MAX; i++) {
+        const PacketTypeStats& stats = packets[i];
+        const char* name = PacketStats::Name(i);
+        size_t bucket = 0;
+        uint64_t count = 0;
+        for (auto bound : sLatencyBounds) {
+            while (bucket < PACKET_STATS_BUCKETS && PacketStats::BucketValue(bucket) <= bound) {
+                count += stats.latency[bucket++];
+            }
+            snprintf(line, sizeof(line), "coopnet_packet_process_seconds_bucket{type=\"%s\",le=\"%g\"} %" PRIu64 "\n", name, bound / 1e9, count);
+            out += line;
+        }
+        while (bucket < PACKET_STATS_BUCKETS) {
+            count += stats.latency[bucket++];
+        }
+        snprintf(line, sizeof(line), "coopnet_packet_process_seconds_bucket{type=\"%s\",le=\"+Inf\"} %" PRIu64 "\n", name, count);
+        out += line;
+        snprintf(line, sizeof(line), "coopnet_packet_process_seconds_sum{type=\"%s\"} %.9f\n", name, stats.latencySumNs / 1e9);
+        out += line;
+        snprintf(line, sizeof(line), "coopnet_packet_process_seconds_count{type=\"%s\"} %" PRIu64 "\n", name, count);
+        out += line;
+    }
+
+    return out;
+}
+
+std::string StatsServer::Json() {
+    int lobbies = 0;
+    int players = 0;
+    mMetrics->Current(&lobbies, &players);
+
+    std::map<std::string, GameCount> games;
+    mMetrics->Games(games);
+    int pending = mMetrics->Pending();
+
+    std::vector<MetricsSeries> series;
+    mMetrics->Series(series);
+
+    std::vector<PacketTypeStats> packets;
+    PacketStats::Snapshot(packets);
+
+    json j;
+    j["lobbies"] = lobbies;
+    j["players"] = players;
+    j["admission_pending"] = pending;
+
+    j["games"] = json::object();
+    for (auto& it : games) {
+        j["games"][it.first] = { { "lobbies", it.second.lobbies }, { "players", it.second.players } };
+    }
+
+    j["series"] = json::object();
+    for (auto& it : series) {
+        sSeriesJson(it, j["series"][it.name]);
+    }
+
+    j["packets"] = json::object();
+    for (uint16_t i = 0; i < MPACKET_MAX; i++) {
+        const PacketTypeStats& stats = packets[i];
+        json& packet = j["packets"][PacketStats::Name(i)];
+        packet["packets_in"] = stats.packetsIn;
+        packet["bytes_in"] = stats.bytesIn;
+        packet["packets_out"] = stats.packetsOut;
+        packet["bytes_out"] = stats.bytesOut;
+        packet["parse_errors"] = stats.parseErrors;
+        packet["receive_errors"] = stats.receiveErrors;
+        packet["latency_us"] = {
+            { "mean", (stats.packetsIn > 0) ? stats.latencySumNs / 1000.0 / stats.packetsIn : 0.0 },
+            { "p50", PacketStats::Percentile(stats, 50) / 1000.0 },
+            { "p99", PacketStats::Percentile(stats, 99) / 1000.0 },
+            { "p999", PacketStats::Percentile(stats, 99.9) / 1000.0 },
+        };
+    }
+
+    // game names come from clients and may not be valid utf-8
+    return j.dump(-1, ' ', false, json::error_handler_t::replace);
+}
+
+bool StatsServer::SeriesJson(const std::string& aName, std::string& aJson) {
+    MetricsSeries series;
+    if (!mMetrics->Series(aName, series)) { return false; }
+
+    json j;
+    sSeriesJson(series, j);
+    aJson = j.dump();
+    return true;
+}
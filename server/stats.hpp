@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <thread>
+#include "metrics.hpp"
+
+// Serves the current counts, the metric series and the packet counters
+// straight from memory, over plain HTTP on a port only this machine can reach.
+//   /metrics      Prometheus text format
+//   /stats.json   the same as JSON
+//   /series/<name>.json   one resolution of the metrics, like secondly or hourly
+// Requests are answered one at a time, it's meant for a scraper or two.
+class StatsServer {
+    private:
+        Metrics* mMetrics = nullptr;
+        int mSocket = -1;
+        std::thread mThread;
+
+        void Respond(int aSocket);
+
+    public:
+        bool Begin(uint16_t aPort, Metrics* aMetrics);
+        void Receive();
+
+        std::string Prometheus();
+        std::string Json();
+        bool SeriesJson(const std::string& aName, std::string& aJson);
+};